@@ -14,9 +14,120 @@
 #include "MixdownFolder.h"
 
 
+//===================================== ThumbnailFeeder =========================================
+
+ThumbnailFeeder::ThumbnailFeeder(WaveformPyramid& thumbnailToFeed) : thumbnail(thumbnailToFeed) {}
+
+void ThumbnailFeeder::prepare(int numChannels, double sampleRate, int capacity) {
+    buffer.setSize(numChannels, capacity);
+    fifo.setTotalSize(capacity);
+    fifo.reset();
+    nextSampleNum = 0;
+    finishRequested = false;
+    thumbnail.reset(numChannels, sampleRate, 0);
+}
+
+void ThumbnailFeeder::push(const float** data, int numSamples) noexcept {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        if (size1 > 0) buffer.copyFrom(ch, start1, data[ch], size1);
+        if (size2 > 0) buffer.copyFrom(ch, start2, data[ch] + size1, size2);
+    }
+
+    fifo.finishedWrite(size1 + size2);
+}
+
+int ThumbnailFeeder::useTimeSlice() {
+    // Checked before the FIFO, so everything pushed before finish() is drained before the take is finished
+    const bool finishing = finishRequested.load();
+    const int numReady = fifo.getNumReady();
+
+    if (numReady == 0) {
+        if (finishing) {
+            finishRequested = false;
+            thumbnail.finishLiveInput();
+        }
+        return 10; // nothing recorded since the last slice; check back shortly
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+    // These wrap regions of our FIFO storage without copying
+    if (size1 > 0) {
+        juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start1, size1);
+        thumbnail.addBlock(nextSampleNum, block, 0, size1);
+        nextSampleNum += size1;
+    }
+    if (size2 > 0) {
+        juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start2, size2);
+        thumbnail.addBlock(nextSampleNum, block, 0, size2);
+        nextSampleNum += size2;
+    }
+
+    fifo.finishedRead(size1 + size2);
+    return 0;
+}
+
+
+//===================================== PreRollBuffer =========================================
+
+void PreRollBuffer::prepare(int numChannels, int capacity) {
+    buffer.setSize(numChannels, capacity);
+    buffer.clear();
+    totalWritten = 0;
+}
+
+void PreRollBuffer::push(const float** data, int numChannels, int numSamples) noexcept {
+    const int capacity = buffer.getNumSamples();
+    if (capacity == 0) return;
+    
+    const auto written = totalWritten.load();
+    const int start = (int) (written % capacity);
+    const int size1 = juce::jmin(numSamples, capacity - start);
+    const int size2 = juce::jmin(numSamples - size1, capacity);
+    
+    for (int ch = 0; ch < juce::jmin(numChannels, buffer.getNumChannels()); ++ch) {
+        if (data[ch] == nullptr) continue;
+        buffer.copyFrom(ch, start, data[ch], size1);
+        if (size2 > 0) buffer.copyFrom(ch, 0, data[ch] + size1, size2);
+    }
+    
+    totalWritten = written + numSamples;
+}
+
+void PreRollBuffer::read(juce::AudioBuffer<float>& dest, const juce::Array<int>& channels,
+                         juce::int64 endPosition, int numSamples) const {
+    const int capacity = buffer.getNumSamples();
+    numSamples = (int) juce::jmin((juce::int64) numSamples, (juce::int64) capacity, endPosition);
+    dest.setSize(channels.size(), juce::jmax(0, numSamples));
+    if (numSamples <= 0) return;
+    
+    const auto startPosition = endPosition - numSamples;
+    const int start = (int) (startPosition % capacity);
+    const int size1 = juce::jmin(numSamples, capacity - start);
+    
+    for (int i = 0; i < channels.size(); ++i) {
+        const int ch = channels[i];
+        if (ch >= buffer.getNumChannels()) { dest.clear(i, 0, numSamples); continue; }
+        dest.copyFrom(i, 0, buffer, ch, start, size1);
+        if (size1 < numSamples) dest.copyFrom(i, size1, buffer, ch, 0, numSamples - size1);
+    }
+    
+    // Anything the audio thread may have overwritten while we copied is unusable. Allow for one block
+    // being written that hasn't been counted in totalWritten yet.
+    const juce::int64 maxBlockInFlight = 8192;
+    const auto firstIntact = totalWritten.load() + maxBlockInFlight - capacity;
+    if (firstIntact > startPosition)
+        dest.clear(0, (int) juce::jmin((juce::int64) numSamples, firstIntact - startPosition));
+}
+
+
 //===================================== AudioRecorder =========================================
 
-AudioRecorder::AudioRecorder(juce::AudioThumbnail& thumbnailToUpdate)  : thumbnail(thumbnailToUpdate) {
+AudioRecorder::AudioRecorder(WaveformPyramid& thumbnailToUpdate)  : thumbnailFeeder(thumbnailToUpdate) {
     backgroundThread.startThread();
 }
 
@@ -24,91 +135,381 @@ AudioRecorder::~AudioRecorder() {
     stopRecording();
 }
 
-void AudioRecorder::startRecording(const juce::File& file, double paddingTime) {
+void AudioRecorder::setCaptureChannels(const juce::Array<int>& inputChannels, CaptureMode mode) {
+    jassert (! inputChannels.isEmpty());
+    captureChannels = inputChannels;
+    captureMode = mode;
+}
+
+int AudioRecorder::getNumFilesPerTake() const {
+    return captureMode == CaptureMode::layerPerInput ? captureChannels.size() : 1;
+}
+
+void AudioRecorder::startRecording(const juce::File& file, double startTime) {
+    startRecording(juce::Array<juce::File> { file }, startTime);
+}
+
+void AudioRecorder::startRecording(const juce::Array<juce::File>& files, double startTime) {
+    beginTake(files, (juce::int64) (juce::jmax(0.0, startTime) * sampleRate));
+}
+
+void AudioRecorder::armRecording(const juce::Array<juce::File>& files) {
+    beginTake(files, playbackSource.load() != nullptr ? -1 : 0);
+}
+
+void AudioRecorder::setPlaybackSource(PlaybackTransport* transport) {
+    auto* old = playbackSource.exchange(nullptr);
+    callbackEpoch.waitForCallbackToFinish();
+    
+    if (old != nullptr) old->releaseResources();
+    if (transport != nullptr && sampleRate > 0) transport->prepareToPlay(blockSize, sampleRate);
+    
+    playbackSource = transport;
+}
+
+void AudioRecorder::beginTake(const juce::Array<juce::File>& files, juce::int64 startSample) {
     stopRecording();
     if (sampleRate <= 0) return;
-    file.deleteFile();
+    jassert (files.size() == getNumFilesPerTake());
     
-    // Open filestream to write to destination file
-    if (auto fileStream = std::unique_ptr<juce::FileOutputStream>(file.createOutputStream())) {
-        // Writes to output stream in correct format
-        juce::WavAudioFormat wavFormat;
+    auto newSession = std::make_unique<RecordingSession>();
+    auto* s = newSession.get();
+    newSession->files = files;
+    newSession->startSample = startSample;
+    newSession->followsPlayback = startSample < 0;
+    newSession->latency = getLatencyCompensation();
+    newSession->splitsAtLoop = cycleRecording;
+    newSession->capturedChannels = captureChannels;
+    newSession->channelPointers.calloc(captureChannels.size());
+    for (int ch : captureChannels)
+        newSession->highestChannel = juce::jmax(newSession->highestChannel, ch);
+    
+    // Keep a second of the ring as slack for the copy. The audio callback trims this further when it punches in.
+    const auto maxPreRoll = juce::jmin((juce::int64) (preRollTime * sampleRate),
+                                       (juce::int64) preRoll.getCapacity() - (juce::int64) sampleRate);
+    newSession->preRollLength = (int) juce::jmax((juce::int64) 0, maxPreRoll);
+    
+    // Size each file's FIFO to ride out a disk stall of diskLatencyBudget, within a memory cap for the whole take
+    const int fifoSize = TakeWriter::getFifoSizeFor(sampleRate, captureChannels.size(), diskLatencyBudget);
+    lastTakeStats = {};
+    
+    // Passes go in layers the project creates, made ahead of time as they're needed on the writer thread
+    if (cycleRecording && createLayerFile != nullptr) {
+        newSession->spares = std::make_shared<RecordingSession::SparePassFiles>();
+        for (int i = 0; i < numSparePassFiles * files.size(); ++i) {
+            auto spare = createLayerFile();
+            if (spare.existsAsFile()) newSession->spares->files.add (spare);
+        }
+    }
+    
+    // Parts of a cycled take follow the loop rather than each other, so they'd be positioned wrongly
+    const auto splitInterval = cycleRecording ? 0 : getSplitInterval(captureMode == CaptureMode::layerPerInput ? 1 : captureChannels.size());
+    
+    for (int i = 0; i < files.size(); ++i) {
+        auto& file = files.getReference(i);
+        auto channels = captureMode == CaptureMode::layerPerInput ? juce::Array<int> { captureChannels[i] }
+                                                                  : captureChannels;
         
-        if (auto writer = wavFormat.createWriterFor(fileStream.get(), sampleRate, 1, 16, {}, 0)) {
-            fileStream.release(); // (passes responsibility for deleting the stream to the writer object that is now using it
-            
-            if (paddingTime > 0.0) padRecording(writer, paddingTime);
-            
-            // Now we'll create one of these helper objects which will act as a FIFO buffer, and will
-            // write the data to disk on our background thread.
-            threadedWriter.reset (new juce::AudioFormatWriter::ThreadedWriter (writer, backgroundThread, 32768)); // Why this buffer size? Is this a randomly large number? @Nolan
-            
-            // Reset our recording thumbnail (which is visualizing our audio input waveform)
-            thumbnail.reset (writer->getNumChannels(), writer->getSampleRate());
-            nextSampleNum = 0;
-            
-            // And now, swap over our active writer pointer so that the audio callback will start using it.
-            const juce::ScopedLock sl (writerLock);
-            activeWriter = threadedWriter.get();
+        if (! file.hasWriteAccess()) throw "Unable to open provided file";
+        
+        // Now we'll create one of these helper objects which will act as a FIFO buffer, and will
+        // write the data to disk on our background thread. The layer's offset into the mixdown lives in
+        // the header, so playback can position it without padding; that isn't known until the take punches
+        // in, so the file is opened when its first audio reaches the writer thread.
+        auto* takeWriter = new TakeWriter ([s, file, rate = sampleRate, numChannels = channels.size(), format = recordingFormat] (juce::int64) {
+            return createLayerWriter (file, rate, numChannels, format, s->layerStart.load());
+        }, channels.size(), recordingFormat, backgroundThread, fifoSize);
+        takeWriter->setHeaderCommitInterval ((int) (headerCommitInterval * sampleRate));
+        newSession->writers.add (takeWriter);
+        newSession->writerChannels.add (channels);
+        
+        // Long takes continue in sibling files, each positioned where the previous one ended
+        if (splitInterval > 0) {
+            takeWriter->setSplitInterval (splitInterval, [s, file, rate = sampleRate, numChannels = channels.size(),
+                                                          format = recordingFormat, part = 1,
+                                                          callback = onNewLayerFile] (juce::int64 samplesWrittenSoFar) mutable {
+                auto nextFile = file.getParentDirectory().getNonexistentChildFile (file.getFileNameWithoutExtension() + "_part" + juce::String (++part),
+                                                                                   file.getFileExtension(), false);
+                auto next = createLayerWriter (nextFile, rate, numChannels, format, s->layerStart.load() + samplesWrittenSoFar);
+                
+                if (next != nullptr && callback != nullptr)
+                    juce::MessageManager::callAsync ([callback, nextFile] { callback (nextFile); });
+                
+                return next;
+            });
         }
-    } else throw "Unable to open provided file";
+        
+        // Each pass of a loop gets a file of its own, positioned at the loop's start. The audio callback marks
+        // the sample each pass begins on, and the writer thread swaps files there. If no spare is ready, the
+        // pass carries on in the current file rather than waiting on the message thread.
+        if (auto spares = newSession->spares) {
+            takeWriter->setMarkedSplits ([spares, rate = sampleRate, numChannels = channels.size(), format = recordingFormat,
+                                          create = createLayerFile] (juce::int64 loopStart) -> std::unique_ptr<juce::AudioFormatWriter> {
+                juce::File nextFile;
+                {
+                    const juce::ScopedLock sl (spares->lock);
+                    if (spares->files.isEmpty()) return nullptr;
+                    nextFile = spares->files.removeAndReturn (0);
+                }
+                
+                juce::MessageManager::callAsync ([spares, create] {
+                    if (spares->closed) return;
+                    auto file = create();
+                    if (! file.existsAsFile()) return;
+                    const juce::ScopedLock sl (spares->lock);
+                    spares->files.add (file);
+                });
+                
+                return createLayerWriter (nextFile, rate, numChannels, format, loopStart);
+            });
+        }
+        
+        // The pre-roll is copied out of the ring on the writer thread, once the audio callback has
+        // marked where the live take begins
+        if (newSession->preRollLength > 0) {
+            takeWriter->setPrelude ([this, s, channels] (juce::AudioBuffer<float>& audio) {
+                const auto end = s->preRollEnd.load();
+                if (end < 0) return false;
+                preRoll.read (audio, channels, end, s->preRollLength);
+                return true;
+            });
+        }
+    }
+    
+    if (newSession->writers.isEmpty()) return;
+    
+    // Reset our recording thumbnail (which is visualizing our audio input waveform). The feeder is
+    // detached from the thread while its FIFO is resized; a second of audio is plenty of slack.
+    backgroundThread.removeTimeSliceClient (&thumbnailFeeder);
+    thumbnailFeeder.prepare (captureChannels.size(), sampleRate, (int) sampleRate);
+    backgroundThread.addTimeSliceClient (&thumbnailFeeder);
+    
+    // And now, swap over our active session pointer so that the audio callback will start using it.
+    session = std::move(newSession);
+    activeSession = session.get();
 }
 
-void AudioRecorder::padRecording(juce::AudioFormatWriter* writer, double paddingTime) {
-    int numSamples = paddingTime * writer->getSampleRate();
-    juce::AudioBuffer<float> padding(writer->getNumChannels(), numSamples);
-    padding.clear();
-    writer->writeFromAudioSampleBuffer(padding, 0, numSamples);
+std::unique_ptr<juce::AudioFormatWriter> AudioRecorder::createLayerWriter(const juce::File& file, double sampleRate, int numChannels,
+                                                                         RecordingFormat format, juce::int64 startSample) {
+    file.deleteFile();
+    
+    // Open filestream to write to destination file
+    auto fileStream = std::unique_ptr<juce::FileOutputStream>(file.createOutputStream());
+    if (fileStream == nullptr) return nullptr;
+    
+    // Writes to output stream in correct format. Past 4 GB, JUCE's WAV writer promotes the header to RF64
+    // in place (it reserves room for the ds64 chunk up front).
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer (wavFormat.createWriterFor(fileStream.get(), sampleRate, (unsigned int) numChannels,
+                                                                              getBitsPerSample(format), Layer::createMetadata(startSample), 0));
+    if (writer != nullptr)
+        fileStream.release(); // (passes responsibility for deleting the stream to the writer object that is now using it
+    
+    return writer;
 }
 
-void AudioRecorder::stopRecording() {
-    // First, clear this pointer to stop the audio callback from using our writer object..
-    {
-        const juce::ScopedLock sl (writerLock);
-        activeWriter = nullptr;
+juce::int64 AudioRecorder::getSplitInterval(int channelsPerFile) const {
+    juce::int64 interval = 0;
+    
+    if (autoSplitTime > 0.0)
+        interval = (juce::int64) (autoSplitTime * sampleRate);
+    
+    if (autoSplitBytes > 0) {
+        const juce::int64 bytesPerFrame = channelsPerFile * getBitsPerSample(recordingFormat) / 8;
+        const auto bySize = autoSplitBytes / juce::jmax((juce::int64) 1, bytesPerFrame);
+        interval = interval > 0 ? juce::jmin(interval, bySize) : bySize;
     }
+    
+    return interval;
+}
 
-    // Now we can delete the writer object. It's done in this order because the deletion could
+void AudioRecorder::stopRecording() {
+    // First, clear this pointer to stop the audio callback from using our writer objects, then wait
+    // for a callback that may still be holding the old pointer to return..
+    activeSession = nullptr;
+    callbackEpoch.waitForCallbackToFinish();
+    
+    if (session == nullptr) return;
+    thumbnailFeeder.finish();
+    lastTakeStats = getWriterStats();
+    
+    const bool started = session->preRollEnd.load() >= 0;
+    const auto files = session->files;
+    const auto spares = session->spares;
+
+    // Now we can delete the writer objects. It's done in this order because the deletion could
     // take a little time while remaining data gets flushed to disk, so it's best to avoid blocking
     // the audio callback while this happens.
-    threadedWriter.reset();
+    session.reset();
+    
+    // A take that was still waiting for playback never opened its files
+    if (! started)
+        for (auto& file : files)
+            file.deleteFile();
+    
+    // As do the layers made for passes that never came
+    if (spares != nullptr) {
+        spares->closed = true;
+        for (auto& file : spares->files)
+            file.deleteFile();
+    }
+}
+
+TakeWriter::Stats AudioRecorder::getWriterStats() const {
+    if (session == nullptr) return lastTakeStats;
+    
+    TakeWriter::Stats total;
+    for (auto* w : session->writers) {
+        auto stats = w->getStats();
+        total.droppedSamples += stats.droppedSamples;
+        total.spilledSamples += stats.spilledSamples;
+        total.fifoSize = stats.fifoSize;
+        total.highWaterMark = juce::jmax(total.highWaterMark, stats.highWaterMark);
+    }
+    return total;
+}
+
+int AudioRecorder::getLatencyCompensation() const {
+    if (! compensateLatency) return 0;
+    return calibratedLatency >= 0 ? calibratedLatency : reportedLatency;
 }
 
 bool AudioRecorder::isRecording() const {
-    return activeWriter.load() != nullptr;
+    return activeSession.load() != nullptr;
 }
 
 void AudioRecorder::audioDeviceAboutToStart(juce::AudioIODevice *device) {
     sampleRate = device->getCurrentSampleRate();
+    blockSize = device->getCurrentBufferSizeSamples();
+    
+    reportedLatency = device->getInputLatencyInSamples() + device->getOutputLatencyInSamples();
+    calibratedLatency = LatencyCalibrator::getStoredLatency(*device);
+    
+    maxOutputs = device->getActiveOutputChannels().countNumberOfSetBits();
+    outputPointers.calloc(juce::jmax(1, maxOutputs));
+    
+    if (auto* transport = playbackSource.load())
+        transport->prepareToPlay(blockSize, sampleRate);
+    
+    // The ring is sized for the longest pre-roll plus slack for the writer thread to copy it out. It can't
+    // be reallocated while a take might still be reading from it.
+    if (session == nullptr)
+        preRoll.prepare (device->getActiveInputChannels().countNumberOfSetBits(),
+                         (int) ((maxPreRollTime + 2.0) * sampleRate));
 }
 
 void AudioRecorder::audioDeviceStopped() {
     sampleRate = 0;
+    
+    if (auto* transport = playbackSource.load())
+        transport->releaseResources();
+}
+
+bool AudioRecorder::punchIn(RecordingSession& s, juce::int64 playbackStart) noexcept {
+    if (s.preRollEnd.load() >= 0) return true; // already running
+    
+    if (s.followsPlayback) {
+        if (playbackStart < 0) return false; // still waiting for playback to start
+        s.startSample = playbackStart;
+    }
+    
+    // The input arriving now is what was played along to latency samples ago, so that's where it belongs
+    const auto liveStart = s.startSample.load() - s.latency;
+    
+    // Pre-roll can't reach further back than the ring has been filled, nor before the start of the mixdown.
+    // If even the live input starts before the mixdown, its beginning is dropped instead.
+    const auto ringPosition = preRoll.getTotalWritten();
+    s.preRollLength = (int) juce::jmax((juce::int64) 0, juce::jmin((juce::int64) s.preRollLength, liveStart, ringPosition));
+    s.samplesToSkip = juce::jmax((juce::int64) 0, -liveStart);
+    s.layerStart = liveStart - s.preRollLength + s.samplesToSkip;
+    
+    // The writer thread only reads the fields above after seeing preRollEnd, so it must be set last
+    s.preRollEnd = ringPosition;
+    return true;
 }
 
 void AudioRecorder::audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
                             float** outputChannelData, int numOutputChannels,
                             int numSamples) {
     
-    const juce::ScopedLock sl(AudioRecorder::writerLock);
+    const CallbackEpoch::ScopedCallback inCallback (callbackEpoch);
+    
+    // Playback is rendered before any input is recorded, so this block's place in the mixdown is known
+    // when a take punches in. Both happen in this one callback, so they share a sample clock.
+    juce::int64 playbackStart = -1;
+    int wrapOffset = -1;
+    juce::int64 wrapTo = 0;
+    
+    if (auto* transport = playbackSource.load()) {
+        int numOutputs = 0;
+        for (int i = 0; i < numOutputChannels && numOutputs < maxOutputs; ++i)
+            if (outputChannelData[i] != nullptr)
+                outputPointers[numOutputs++] = outputChannelData[i];
+        
+        juce::AudioBuffer<float> output (outputPointers, numOutputs, numSamples);
+        transport->getNextAudioBlock (juce::AudioSourceChannelInfo (output));
+        
+        // Where the block came from is only known once the transport has applied any seek queued for it
+        const auto& block = transport->getLastBlockInfo();
+        if (block.playing) {
+            playbackStart = block.start;
+            wrapOffset = block.wrapOffset;
+            wrapTo = block.wrapTo;
+        }
+    } else {
+        for (int i = 0; i < numOutputChannels; ++i)
+            if (outputChannelData[i] != nullptr)
+                juce::FloatVectorOperations::clear (outputChannelData[i], numSamples);
+    }
+    
+    auto* s = activeSession.load();
 
-    if (activeWriter.load() != nullptr && numInputChannels >= thumbnail.getNumChannels()) // This seems funky; why would we compare numInput channels with the thumbnail channels? I thought the thumbnail was just used for painting waveforms @Nolan
+    if (s != nullptr && numInputChannels > s->highestChannel && punchIn (*s, playbackStart))
     {
-        activeWriter.load()->write (inputChannelData, numSamples);
-
-        // Create an AudioBuffer to wrap our incoming data, note that this does no allocations or copies, it simply references our input data
-        juce::AudioBuffer<float> buffer (const_cast<float**> (inputChannelData), thumbnail.getNumChannels(), numSamples);
-        thumbnail.addBlock (nextSampleNum, buffer, 0, numSamples);
-        nextSampleNum += numSamples;
+        auto* pointers = s->channelPointers.get();
+        
+        // Latency compensation may mean the first few blocks of live input come before the mixdown starts
+        const int skip = (int) juce::jmin((juce::int64) numSamples, s->samplesToSkip);
+        s->samplesToSkip -= skip;
+        const int numToWrite = numSamples - skip;
+        
+        // The input in time with the loop's start arrives latency samples after playback wrapped, and the
+        // pass's file starts with it. That may be in a later block, so the split is marked ahead of time.
+        const juce::int64 passOffset = s->splitsAtLoop && wrapOffset >= 0 ? wrapOffset - skip + s->latency : -1;
+        
+        for (int i = 0; i < s->writers.size(); ++i) {
+            auto* writer = s->writers.getUnchecked (i);
+            bool written = true;
+            
+            if (numToWrite > 0) {
+                auto& channels = s->writerChannels.getReference (i);
+                for (int ch = 0; ch < channels.size(); ++ch)
+                    pointers[ch] = inputChannelData[channels.getUnchecked (ch)] + skip;
+                
+                written = writer->write (pointers, numToWrite);
+            }
+            
+            // Split positions count only what each writer accepted. If the pass starts in a block its FIFO had
+            // no room for, its file starts with the next block that gets through.
+            if (passOffset >= 0) {
+                const auto accepted = writer->getNumSamplesAccepted();
+                auto passStart = accepted + passOffset - numToWrite;
+                if (! written) passStart = juce::jmax (passStart, accepted);
+                if (passStart > 0) writer->markSplit (passStart, wrapTo);
+            }
+        }
+        
+        if (numToWrite > 0) {
+            // Only a copy happens here; the thumbnail is updated on the background thread
+            for (int ch = 0; ch < s->capturedChannels.size(); ++ch)
+                pointers[ch] = inputChannelData[s->capturedChannels.getUnchecked(ch)] + skip;
+            
+            thumbnailFeeder.push (pointers, numToWrite);
+        }
     }
-
-    // We need to clear the output buffers, in case they're full of junk..
-    // Why do we need to do this? @Nolan
-    //
-    // TODO: Confirm that buffer clearance does not interfere with other components
-    for (int i = 0; i < numOutputChannels; ++i)
-        if (outputChannelData[i] != nullptr)
-            juce::FloatVectorOperations::clear (outputChannelData[i], numSamples);
+    
+    // Always keep the most recent input, whether or not we're recording
+    preRoll.push (inputChannelData, numInputChannels, numSamples);
 }
 
 
@@ -123,7 +524,7 @@ RecordingThumbnail::~RecordingThumbnail() {
     thumbnail.removeChangeListener(this);
 }
 
-juce::AudioThumbnail& RecordingThumbnail::getAudioThumbnail() { return thumbnail; }
+WaveformPyramid& RecordingThumbnail::getAudioThumbnail() { return thumbnail; }
 
 void RecordingThumbnail::setDisplayFullThumbnail(bool displayFull) {
     displayFullThumb = displayFull;
@@ -197,7 +598,7 @@ void LiveScrollingAudioDisplay::audioDeviceIOCallback(const float **inputChannel
 
 //===================================== LayerRecorderComponent =========================================
 
-LayerRecorderComponent::LayerRecorderComponent(juce::AudioDeviceManager& adm) : audioDeviceManager(adm), currProject(nullptr), transport(nullptr) {
+LayerRecorderComponent::LayerRecorderComponent(juce::AudioDeviceManager& adm) : audioDeviceManager(adm), playbackComp(nullptr), currProject(nullptr), transport(nullptr) {
     setOpaque (true);
     //addAndMakeVisible (liveAudioScroller);
 
@@ -218,6 +619,80 @@ LayerRecorderComponent::LayerRecorderComponent(juce::AudioDeviceManager& adm) :
     };
     recordButton.setEnabled(false); // disabled until a project is loaded
 
+    // Takes that are split into several files add the later parts to the project as they are opened
+    recorder.onNewLayerFile = [safeThis = SafePointer<LayerRecorderComponent> (this)] (const juce::File& file) {
+        if (safeThis != nullptr && safeThis->currProject != nullptr
+            && file.getParentDirectory() == safeThis->currProject->getLayerDirectory()) {
+            safeThis->currProject->layers.add (Layer (file));
+            safeThis->currProject->layersChanged();
+        }
+    };
+    
+    // Each pass of a cycled take is recorded into a layer of its own
+    recorder.createLayerFile = [this] {
+        return currProject != nullptr ? currProject->createNewLayer() : juce::File();
+    };
+
+    addAndMakeVisible (inputsButton);
+    inputsButton.onClick = [this] { showInputMenu(); };
+    updateInputButtonText();
+
+    addAndMakeVisible (captureModeBox);
+    captureModeBox.addItem ("One layer", 1);
+    captureModeBox.addItem ("Layer per input", 2);
+    captureModeBox.setSelectedId (1, juce::dontSendNotification);
+
+    addAndMakeVisible (formatBox);
+    formatBox.addItem ("16-bit", 1);
+    formatBox.addItem ("24-bit", 2);
+    formatBox.addItem ("32-bit float", 3);
+    formatBox.setSelectedId (1, juce::dontSendNotification);
+    formatBox.onChange = [this] {
+        const RecordingFormat formats[] = { RecordingFormat::int16, RecordingFormat::int24, RecordingFormat::float32 };
+        recorder.setRecordingFormat (formats[formatBox.getSelectedId() - 1]);
+    };
+
+    addAndMakeVisible (preRollToggle);
+    preRollToggle.setToggleState (true, juce::dontSendNotification);
+    preRollToggle.onClick = [this] { recorder.setPreRollTime (preRollToggle.getToggleState() ? 5.0 : 0.0); };
+
+    addAndMakeVisible (latencyToggle);
+    latencyToggle.setToggleState (true, juce::dontSendNotification);
+    latencyToggle.onClick = [this] { recorder.setLatencyCompensation (latencyToggle.getToggleState()); };
+
+    addAndMakeVisible (calibrateButton);
+    calibrateButton.onClick = [this] { startCalibration(); };
+
+    addAndMakeVisible (cycleToggle);
+    cycleToggle.setTooltip ("While playback loops, record each pass as a new layer");
+    cycleToggle.onClick = [this] { recorder.setCycleRecording (cycleToggle.getToggleState()); };
+
+    addAndMakeVisible (splitBox);
+    splitBox.setTooltip ("Split long takes into several layers that play back seamlessly");
+    splitBox.addItem ("No splitting", 1);
+    splitBox.addItem ("Split every 30 min", 2);
+    splitBox.addItem ("Split every hour", 3);
+    splitBox.addItem ("Split at 2 GB", 4);
+    splitBox.setSelectedId (1, juce::dontSendNotification);
+    splitBox.onChange = [this] {
+        const double times[] = { 0.0, 30.0 * 60.0, 60.0 * 60.0, 0.0 };
+        const juce::int64 sizes[] = { 0, 0, 0, (juce::int64) 2 << 30 };
+        const int index = splitBox.getSelectedId() - 1;
+        recorder.setAutoSplit (times[index], sizes[index]);
+    };
+
+    addAndMakeVisible (diskBufferBox);
+    diskBufferBox.setTooltip ("How long the disk can stall before recorded audio is held in spill memory instead");
+    diskBufferBox.addItem ("1 s disk buffer", 1);
+    diskBufferBox.addItem ("2 s disk buffer", 2);
+    diskBufferBox.addItem ("5 s disk buffer", 3);
+    diskBufferBox.addItem ("10 s disk buffer", 4);
+    diskBufferBox.setSelectedId (2, juce::dontSendNotification);
+    diskBufferBox.onChange = [this] {
+        const double budgets[] = { 1.0, 2.0, 5.0, 10.0 };
+        recorder.setDiskLatencyBudget (budgets[diskBufferBox.getSelectedId() - 1]);
+    };
+
     addAndMakeVisible (recordingThumbnail);
 
     juce::RuntimePermissions::request (juce::RuntimePermissions::recordAudio,
@@ -233,6 +708,8 @@ LayerRecorderComponent::LayerRecorderComponent(juce::AudioDeviceManager& adm) :
 }
 
 LayerRecorderComponent::~LayerRecorderComponent() {
+    if (calibrator != nullptr)
+        audioDeviceManager.removeAudioCallback (calibrator.get());
     audioDeviceManager.removeAudioCallback (&recorder);
     audioDeviceManager.removeAudioCallback (&liveAudioScroller);
 }
@@ -246,7 +723,18 @@ void LayerRecorderComponent::resized() {
 
     //liveAudioScroller .setBounds (area.removeFromTop (80).reduced (8));
     recordingThumbnail.setBounds (area.removeFromTop (80).reduced (8));
-    recordButton      .setBounds (area.removeFromTop (36).removeFromLeft (140).reduced (8));
+    auto buttonRow = area.removeFromTop (36);
+    recordButton      .setBounds (buttonRow.removeFromLeft (140).reduced (8));
+    inputsButton      .setBounds (buttonRow.removeFromLeft (120).reduced (8));
+    captureModeBox    .setBounds (buttonRow.removeFromLeft (150).reduced (8));
+    formatBox         .setBounds (buttonRow.removeFromLeft (130).reduced (8));
+    preRollToggle     .setBounds (buttonRow.removeFromLeft (100).reduced (8));
+    auto latencyRow = area.removeFromTop (36);
+    calibrateButton   .setBounds (latencyRow.removeFromLeft (160).reduced (8));
+    latencyToggle     .setBounds (latencyRow.removeFromLeft (180).reduced (8));
+    cycleToggle       .setBounds (latencyRow.removeFromLeft (100).reduced (8));
+    splitBox          .setBounds (latencyRow.removeFromLeft (170).reduced (8));
+    diskBufferBox     .setBounds (latencyRow.removeFromLeft (150).reduced (8));
     explanationLabel  .setBounds (area.reduced (8));
 }
 
@@ -256,8 +744,9 @@ void LayerRecorderComponent::setProject(Project *p) {
     explanationLabel.setText("Press to record a new layer for project " + p->getName(), juce::sendNotification);
 }
 
-void LayerRecorderComponent::setTransport(juce::AudioTransportSource* ats) {
+void LayerRecorderComponent::setTransport(PlaybackTransport* ats) {
     this->transport = ats;
+    recorder.setPlaybackSource(ats);
 }
 void LayerRecorderComponent::setPlaybackComp(MixdownFolderComp* playbackComp) {
     this->playbackComp = playbackComp;
@@ -274,18 +763,167 @@ void LayerRecorderComponent::startRecording() {
         return;
     }
 
-    Layer newLayer = currProject->createNewLayer();
-    recorder.startRecording (newLayer.getFile(), transport->getCurrentPosition());
+    // Work out which inputs to capture from the currently open device
+    int numInputs = 0;
+    if (auto* device = audioDeviceManager.getCurrentAudioDevice())
+        numInputs = device->getActiveInputChannels().countNumberOfSetBits();
+    if (numInputs == 0) return;
+
+    // Inputs the device no longer has are left out, but something is always recorded
+    juce::Array<int> channels;
+    for (int ch : selectedInputs)
+        if (ch < numInputs) channels.add (ch);
+    if (channels.isEmpty()) channels.add (0);
+
+    recorder.setCaptureChannels (channels, captureModeBox.getSelectedId() == 2 ? AudioRecorder::CaptureMode::layerPerInput
+                                                                               : AudioRecorder::CaptureMode::singleLayer);
+
+    juce::Array<juce::File> layerFiles;
+    for (int i = 0; i < recorder.getNumFilesPerTake(); ++i)
+        layerFiles.add (currProject->createNewLayer());
+
+    // The take starts on the very sample playback does, rather than wherever the transport was when we asked
+    recorder.armRecording (layerFiles);
     isCurrentlyRecording = true;
     playbackComp->triggerPlayback();
 
     recordButton.setButtonText ("Stop");
+    inputsButton.setEnabled (false);
+    captureModeBox.setEnabled (false);
+    formatBox.setEnabled (false);
+    calibrateButton.setEnabled (false);
+    cycleToggle.setEnabled (false);
+    splitBox.setEnabled (false);
+    diskBufferBox.setEnabled (false);
     recordingThumbnail.setDisplayFullThumbnail (false);
+    startTimerHz (4);
 }
 
 void LayerRecorderComponent::stopRecording() {
     recorder.stopRecording();
+    
+    // Forget layers whose take was discarded before playback started
+    if (currProject != nullptr
+        && currProject->layers.removeIf ([] (Layer& layer) { return ! layer.getFile().existsAsFile(); }) > 0)
+        currProject->layersChanged();
+    
+    // Let the new take be heard alongside the mixdown
+    if (playbackComp != nullptr)
+        playbackComp->reloadLayers();
+
     isCurrentlyRecording = false;
     recordButton.setButtonText ("Record");
+    inputsButton.setEnabled (true);
+    captureModeBox.setEnabled (true);
+    formatBox.setEnabled (true);
+    calibrateButton.setEnabled (true);
+    cycleToggle.setEnabled (true);
+    splitBox.setEnabled (true);
+    diskBufferBox.setEnabled (true);
     recordingThumbnail.setDisplayFullThumbnail (true);
+    stopTimer();
+    showWriterStats();
+}
+
+void LayerRecorderComponent::timerCallback() {
+    if (calibrator != nullptr) {
+        if (calibrator->isFinished()) finishCalibration();
+        return;
+    }
+    
+    showWriterStats();
+}
+
+void LayerRecorderComponent::startCalibration() {
+    if (recorder.isRecording() || calibrator != nullptr || audioDeviceManager.getCurrentAudioDevice() == nullptr) return;
+    
+    // The mixdown would come back through the loopback too
+    if (transport != nullptr) transport->stop();
+    
+    calibrator = std::make_unique<LatencyCalibrator> (0);
+    audioDeviceManager.addAudioCallback (calibrator.get());
+    
+    recordButton.setEnabled (false);
+    calibrateButton.setEnabled (false);
+    explanationLabel.setText ("Measuring latency... Connect an output to the first input, and keep the volume moderate.",
+                              juce::dontSendNotification);
+    startTimerHz (10);
+}
+
+void LayerRecorderComponent::finishCalibration() {
+    stopTimer();
+    audioDeviceManager.removeAudioCallback (calibrator.get());
+    const int latency = calibrator->computeLatency();
+    calibrator.reset();
+    
+    recordButton.setEnabled (currProject != nullptr);
+    calibrateButton.setEnabled (true);
+    
+    auto* device = audioDeviceManager.getCurrentAudioDevice();
+    if (latency < 0 || device == nullptr) {
+        explanationLabel.setText ("The test signal didn't come back. Check the loopback connection and try again.",
+                                  juce::dontSendNotification);
+        return;
+    }
+    
+    // Remembered for this device, so it's applied as soon as the device next opens
+    LatencyCalibrator::storeLatency (*device, latency);
+    recorder.setCalibratedLatency (latency);
+    
+    const int reported = device->getInputLatencyInSamples() + device->getOutputLatencyInSamples();
+    explanationLabel.setText ("Round-trip latency: " + juce::String (latency) + " samples ("
+                              + juce::String (1000.0 * latency / device->getCurrentSampleRate(), 1) + " ms; the driver reports "
+                              + juce::String (reported) + "). New layers will be shifted back by this much.",
+                              juce::dontSendNotification);
+}
+
+void LayerRecorderComponent::showWriterStats() {
+    auto stats = recorder.getWriterStats();
+    if (stats.droppedSamples == 0 && stats.spilledSamples == 0) return;
+    
+    juce::String message;
+    if (stats.droppedSamples > 0)
+        message << "Warning: " << stats.droppedSamples << " samples were dropped because the disk couldn't keep up. ";
+    else
+        message << "The disk fell behind; " << stats.spilledSamples << " samples went through the spill buffer. ";
+    message << "Peak buffer use: " << juce::roundToInt(100.0 * stats.highWaterMark / juce::jmax(1, stats.fifoSize)) << "%";
+    
+    explanationLabel.setText (message, juce::dontSendNotification);
+}
+
+void LayerRecorderComponent::showInputMenu() {
+    auto* device = audioDeviceManager.getCurrentAudioDevice();
+    if (device == nullptr) return;
+    
+    // Menu item IDs are the active input's index plus one
+    const auto names = device->getInputChannelNames();
+    const auto active = device->getActiveInputChannels();
+    
+    juce::PopupMenu menu;
+    for (int bit = active.findNextSetBit (0), index = 0; bit >= 0; bit = active.findNextSetBit (bit + 1), ++index)
+        menu.addItem (index + 1, names[bit].isNotEmpty() ? names[bit] : "Input " + juce::String (index + 1),
+                      true, selectedInputs.contains (index));
+    
+    menu.showMenuAsync (juce::PopupMenu::Options().withTargetComponent (&inputsButton),
+                        [safeThis = SafePointer<LayerRecorderComponent> (this)] (int result) {
+        if (safeThis == nullptr || result == 0) return;
+        
+        auto& inputs = safeThis->selectedInputs;
+        const int index = result - 1;
+        if (inputs.contains (index)) {
+            if (inputs.size() > 1) inputs.removeFirstMatchingValue (index); // always keep one
+        } else {
+            inputs.addSorted (juce::DefaultElementComparator<int>(), index);
+        }
+        
+        safeThis->updateInputButtonText();
+    });
+}
+
+void LayerRecorderComponent::updateInputButtonText() {
+    juce::StringArray numbers;
+    for (int ch : selectedInputs)
+        numbers.add (juce::String (ch + 1));
+    
+    inputsButton.setButtonText ((selectedInputs.size() == 1 ? "Input " : "Inputs ") + numbers.joinIntoString (", "));
 }
@@ -14,29 +14,262 @@
 
 #include <JuceHeader.h>
 #include "ProjectManagement.h"
+#include "RealtimeSync.h"
+#include "PlaybackTransport.h"
+#include "TakeWriter.h"
+#include "LatencyCalibration.h"
+#include "PeakCache.h"
+#include "WaveformPyramid.h"
 class MixdownFolderComp;
 
 
+/**
+ A lock-free single-producer/single-consumer FIFO of recorded samples that feeds a WaveformPyramid.
+
+ The audio callback only copies each block into the FIFO with push(); the TimeSliceThread this client
+ is registered with drains it and calls WaveformPyramid::addBlock(), so the thumbnail's internal lock and
+ min/max reduction never run on the real-time thread.
+ */
+class ThumbnailFeeder : public juce::TimeSliceClient {
+public:
+    ThumbnailFeeder(WaveformPyramid& thumbnailToFeed);
+    
+    /**
+     Resets the thumbnail and resizes the FIFO. Must not be called while the audio callback may push or
+     while this client is registered with a running thread.
+     @param numChannels     Number of channels that will be pushed.
+     @param sampleRate      Sample rate of the pushed audio.
+     @param capacity        Number of samples per channel the FIFO can hold.
+     */
+    void prepare(int numChannels, double sampleRate, int capacity);
+    
+    /**
+     Copies a block of audio into the FIFO. Real-time safe. Samples that don't fit are dropped, which only
+     affects the drawn waveform.
+     */
+    void push(const float** data, int numSamples) noexcept;
+    
+    /**
+     Mark the end of a take, once the audio callback has stopped pushing. The thumbnail is finished once
+     everything pushed before this has been drained.
+     */
+    void finish() noexcept { finishRequested = true; }
+    
+    int getNumChannels() const noexcept { return buffer.getNumChannels(); }
+    
+    int useTimeSlice() override;
+    
+private:
+    WaveformPyramid& thumbnail;
+    juce::AbstractFifo fifo { 1 };
+    juce::AudioBuffer<float> buffer;
+    juce::int64 nextSampleNum = 0; // only touched by the consuming thread (and prepare())
+    std::atomic<bool> finishRequested { false };
+    
+    JUCE_DECLARE_NON_COPYABLE (ThumbnailFeeder)
+};
+
+
+/**
+ A preallocated ring buffer that always holds the most recent input, so a take can begin a few seconds
+ before Record was pressed.
+
+ Only the audio thread writes to it, and it never waits. A background thread copies the pre-roll out with
+ read(), which detects (and silences) any samples the audio thread overwrote while it was copying.
+ */
+class PreRollBuffer {
+public:
+    PreRollBuffer() = default;
+    
+    /**
+     Allocate the ring. Must not be called while push() or read() may run.
+     @param numChannels     Number of device input channels to keep.
+     @param capacity        Number of samples per channel to keep.
+     */
+    void prepare(int numChannels, int capacity);
+    
+    /**
+     Append a block of input. Real-time safe.
+     */
+    void push(const float** data, int numChannels, int numSamples) noexcept;
+    
+    /**
+     Total number of samples ever pushed; positions passed to read() are in this timeline.
+     */
+    juce::int64 getTotalWritten() const noexcept { return totalWritten.load(); }
+    
+    int getCapacity() const noexcept { return buffer.getNumSamples(); }
+    
+    /**
+     Copy the numSamples samples that precede endPosition on the given channels into dest, resizing it.
+     */
+    void read(juce::AudioBuffer<float>& dest, const juce::Array<int>& channels, juce::int64 endPosition, int numSamples) const;
+    
+private:
+    juce::AudioBuffer<float> buffer;
+    std::atomic<juce::int64> totalWritten { 0 };
+    
+    JUCE_DECLARE_NON_COPYABLE (PreRollBuffer)
+};
+
+
 /** A simple class that acts as an AudioIODeviceCallback and writes the
-    incoming audio data to a WAV file.
+    incoming audio data to WAV files.
+ 
+    Any set of the device's input channels can be captured in one pass, either interleaved into a single
+    multichannel file or fanned out to one mono file per input. Every file gets its own bounded FIFO, and
+    all of them are drained by the same background writer thread.
 */
 class AudioRecorder : public juce::AudioIODeviceCallback {
 public:
+    /** How the captured input channels are laid out on disk. */
+    enum class CaptureMode {
+        singleLayer,    // all captured channels interleaved into one file
+        layerPerInput   // one mono file per captured channel
+    };
+    
     /**
      Creates a new AudioRecorder.
      @param thumbnailToUpdate   A thumbnail for this AudioRecorder to update as it records.
      */
-    AudioRecorder(juce::AudioThumbnail& thumbnailToUpdate);
+    AudioRecorder(WaveformPyramid& thumbnailToUpdate);
     ~AudioRecorder() override;
     
+    /**
+     Choose which inputs the next recording captures. Defaults to the first input only, in a single layer.
+     @param inputChannels   Indices into the device's active input channels.
+     @param mode            Whether to interleave the channels into one file or write one file per channel.
+     */
+    void setCaptureChannels(const juce::Array<int>& inputChannels, CaptureMode mode);
+    
+    /**
+     The number of files startRecording() expects for the current capture settings.
+     */
+    int getNumFilesPerTake() const;
+    
+    /**
+     Choose the sample format of subsequent recordings. Defaults to 16-bit.
+     */
+    void setRecordingFormat(RecordingFormat newFormat) { recordingFormat = newFormat; }
+    
+    /**
+     Set how much input from before startRecording() is included at the start of each take. Input is kept
+     in a ring buffer whenever the device is running, so this is "retroactive record". Defaults to 5 seconds;
+     0 turns it off.
+     @param seconds     Clamped to maxPreRollTime.
+     */
+    void setPreRollTime(double seconds) { preRollTime = juce::jlimit(0.0, maxPreRollTime, seconds); }
+    
+    static constexpr double maxPreRollTime = 10.0;
+    
+    /**
+     Set how long a disk stall subsequent takes should absorb in their primary FIFOs before spilling.
+     Defaults to 2 seconds.
+     */
+    void setDiskLatencyBudget(double seconds) { diskLatencyBudget = juce::jmax(0.1, seconds); }
+    
+    /**
+     Set how often subsequent takes commit their WAV headers to disk, bounding how much audio a crash or
+     power loss can make unreadable. Defaults to 1 second; 0 only writes headers when a take stops.
+     */
+    void setHeaderCommitInterval(double seconds) { headerCommitInterval = juce::jmax(0.0, seconds); }
+    
+    /**
+     Split subsequent takes into sequential layer files once a file reaches a length or size limit. Each new
+     file is named after the first with a "_part" suffix and carries its own start offset, so the parts play
+     back seamlessly. Files past 4 GB are written as RF64 whether or not splitting is on.
+     @param maxSeconds  Length limit per file; 0 for none.
+     @param maxBytes    Size limit per file, in bytes of audio; 0 for none.
+     */
+    void setAutoSplit(double maxSeconds, juce::int64 maxBytes) { autoSplitTime = maxSeconds; autoSplitBytes = maxBytes; }
+    
+    /**
+     Record each pass of a looping playback source into its own layer file, for cycle recording. The take is
+     still one uninterrupted stream from the device to the writer thread, which starts a new file on exactly
+     the sample each pass begins, so nothing is lost at the seams. Each file after the first comes from
+     createLayerFile, and is positioned at the start of the loop. Takes split this way aren't also split by
+     setAutoSplit(). Off by default.
+     */
+    void setCycleRecording(bool splitAtLoop) { cycleRecording = splitAtLoop; }
+    
+    /**
+     Compensate subsequent takes for the device's round-trip latency, so a layer lines up with what was heard
+     while it was played rather than arriving late by the time audio takes to leave and re-enter the interface.
+     Uses the latency last calibrated for the device if there is one, and the driver-reported latency
+     otherwise. On by default.
+     */
+    void setLatencyCompensation(bool shouldCompensate) { compensateLatency = shouldCompensate; }
+    
+    /**
+     The round-trip latency, in samples, that takes are currently shifted back by.
+     */
+    int getLatencyCompensation() const;
+    
+    /**
+     Whether the current device's latency came from a LatencyCalibrator rather than its driver.
+     */
+    bool isLatencyCalibrated() const { return calibratedLatency >= 0; }
+    
+    /**
+     Use a measured round-trip latency for the current device until it is closed. To have it applied the next
+     time the device opens, store it with LatencyCalibrator::storeLatency() as well.
+     @param latencySamples  The latency in samples, or -1 to go back to the driver-reported latency.
+     */
+    void setCalibratedLatency(int latencySamples) { calibratedLatency = latencySamples; }
+    
+    /**
+     Called on the message thread whenever a take continues into a new layer file (see setAutoSplit()).
+     */
+    std::function<void (const juce::File&)> onNewLayerFile;
+    
+    /**
+     Called on the message thread to create the layer files the passes of a cycled take go in (see
+     setCycleRecording()), so they're named and added to the project like any other layer. Since a pass can
+     begin at any moment, a few are created when the take starts and each one used is replaced; those left
+     over when it stops are deleted. Without it, cycled takes are recorded into one file per input.
+     */
+    std::function<juce::File()> createLayerFile;
+    
+    static constexpr int numSparePassFiles = 2; // per file of the take
+    
+    /**
+     Get the disk writer counters for the current take, summed over its files (the FIFO figures are for the
+     fullest one). Once a take stops, this keeps returning that take's final counters until the next starts.
+     */
+    TakeWriter::Stats getWriterStats() const;
+    
+    /**
+     Render playback from this transport inside the recorder's own device callback, so that recording and
+     playback run off one sample clock and a take can start on exactly the sample playback does. The transport
+     is prepared and released along with the device. Pass nullptr to stop rendering playback.
+     */
+    void setPlaybackSource(PlaybackTransport* transport);
+    
+    /**
+     Arm a take that starts with playback: it begins on the first block the playback source renders after this
+     call (the next block, if playback is already running), and is positioned at that block's place in the
+     mixdown. Without a playback source, recording starts straight away at the beginning of the mixdown.
+     @param files       Files to record to; must contain getNumFilesPerTake() files.
+     */
+    void armRecording(const juce::Array<juce::File>& files);
+    
     /**
      Begin recording.
+     @param files       Files to record to; must contain getNumFilesPerTake() files.
+     @param startTime   Position in the project's mixdown, in seconds, at which the take starts. Stored in
+                        each file's BWF time reference rather than as leading silence. Pre-roll moves the
+                        layer's start earlier, but never before the start of the mixdown.
+     */
+    void startRecording(const juce::Array<juce::File>& files, double startTime=0.0);
+    
+    /**
+     Begin recording into a single file.
      @param file    File to record to.
      */
-    void startRecording(const juce::File& file, double paddingTime=0.0);
+    void startRecording(const juce::File& file, double startTime=0.0);
     
     /**
-     Stop recording.
+     Stop recording. An armed take that never started is discarded, and its files deleted.
      */
     void stopRecording();
     
@@ -66,17 +299,86 @@ public:
                                 int numSamples) override;
     
 private:
-    void padRecording(juce::AudioFormatWriter*, double paddingTime);
+    /**
+     Everything the audio callback needs for one take. Built on the message thread, then published to the
+     callback through activeSession.
+     */
+    struct RecordingSession {
+        ~RecordingSession() { writers.clear(); } // writers may still use the fields below while flushing
+        
+        juce::Array<juce::File> files;
+        juce::OwnedArray<TakeWriter> writers;          // FIFO buffers for incoming data, one per file
+        juce::Array<juce::Array<int>> writerChannels;  // device input channels feeding each writer
+        juce::Array<int> capturedChannels;             // every captured input, in file order (for the thumbnail)
+        juce::HeapBlock<const float*> channelPointers; // scratch space so the callback never allocates
+        int highestChannel = 0;
+        
+        // The take's position in the mixdown, in samples. A take that follows playback only learns it when the
+        // audio callback punches in; until then it's -1.
+        std::atomic<juce::int64> startSample { -1 };
+        bool followsPlayback = false;
+        int latency = 0; // round trip to compensate for, in samples
+        
+        // Set by the audio callback when it punches in: the pre-roll timeline position of the take's first
+        // live sample. The pre-roll is the preRollLength samples before it, and is trimmed at the same time
+        // so it doesn't reach before the start of the mixdown.
+        std::atomic<juce::int64> preRollEnd { -1 };
+        int preRollLength = 0;
+        
+        // Also set on punching in: where the file starts in the mixdown once pre-roll and latency are
+        // accounted for, and how much live input to drop so that it never starts before the mixdown does.
+        std::atomic<juce::int64> layerStart { 0 };
+        juce::int64 samplesToSkip = 0; // only touched by the audio thread after punching in
+        
+        bool splitsAtLoop = false;     // whether each pass of a loop goes in a file of its own
+        
+        // Layer files created ahead of time for the passes of a cycled take. Taken on the writer thread, and
+        // topped up and finally closed on the message thread.
+        struct SparePassFiles {
+            juce::CriticalSection lock;
+            juce::Array<juce::File> files;
+            bool closed = false; // once the take has stopped; only touched on the message thread
+        };
+        std::shared_ptr<SparePassFiles> spares;
+    };
+    
+    void beginTake(const juce::Array<juce::File>& files, juce::int64 startSample);
     
-    juce::AudioThumbnail& thumbnail; // for drawing scaled view of audio waveform
-    juce::TimeSliceThread backgroundThread { "Audio Recorder Thread" }; // this thread writes audio data to disk
-    std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter> threadedWriter; // FIFO buffer for incoming data
+    /** Starts the take on this block if it's due. Audio thread only. @return True if the take is running. */
+    bool punchIn(RecordingSession&, juce::int64 playbackStart) noexcept;
+    
+    static std::unique_ptr<juce::AudioFormatWriter> createLayerWriter(const juce::File&, double sampleRate, int numChannels,
+                                                                      RecordingFormat, juce::int64 startSample);
+    juce::int64 getSplitInterval(int channelsPerFile) const;
+    
+    ThumbnailFeeder thumbnailFeeder; // for drawing scaled view of audio waveform, fed off the audio thread
+    PreRollBuffer preRoll;           // the last few seconds of input, ready to be put in front of a take
+    double preRollTime = 5.0;
+    juce::TimeSliceThread backgroundThread { "Audio Recorder Thread" }; // this thread writes audio data to disk and feeds the thumbnail
+    std::unique_ptr<RecordingSession> session;
     double sampleRate = 0.0;
-    juce::int64 nextSampleNum = 0;
+    int blockSize = 0;
+    juce::HeapBlock<float*> outputPointers; // scratch space for wrapping the device outputs
+    int maxOutputs = 0;
+    
+    juce::Array<int> captureChannels { 0 };
+    CaptureMode captureMode = CaptureMode::singleLayer;
+    RecordingFormat recordingFormat = RecordingFormat::int16;
+    double diskLatencyBudget = 2.0;
+    double headerCommitInterval = 1.0;
+    double autoSplitTime = 0.0;
+    juce::int64 autoSplitBytes = 0;
+    bool cycleRecording = false;
+    bool compensateLatency = true;
+    int reportedLatency = 0;    // input plus output latency, as reported by the driver
+    int calibratedLatency = -1; // measured for the current device, if it has been
+    TakeWriter::Stats lastTakeStats;
     
-    // Thread safety
-    juce::CriticalSection writerLock;
-    std::atomic<juce::AudioFormatWriter::ThreadedWriter*> activeWriter { nullptr };
+    // Thread safety. The audio callback never locks: it only reads activeSession, and the message
+    // thread waits on callbackEpoch before deleting a session it has just unpublished.
+    CallbackEpoch callbackEpoch;
+    std::atomic<RecordingSession*> activeSession { nullptr };
+    std::atomic<PlaybackTransport*> playbackSource { nullptr };
 };
 
 
@@ -92,7 +394,7 @@ public:
      Get this RecordingThumbnail's audio thumbnail.
      @return A pointer to an audio thumbnail.
      */
-    juce::AudioThumbnail& getAudioThumbnail();
+    WaveformPyramid& getAudioThumbnail();
     
     /**
      Display full thumbnail.
@@ -104,8 +406,8 @@ public:
 
 private:
     juce::AudioFormatManager formatManager;
-    juce::AudioThumbnailCache thumbnailCache  { 10 };
-    juce::AudioThumbnail thumbnail            { 512, formatManager, thumbnailCache };
+    juce::SharedResourcePointer<PeakCache> thumbnailCache;
+    WaveformPyramid thumbnail                 { formatManager, *thumbnailCache };
 
     bool displayFullThumb = false;
 
@@ -149,7 +451,7 @@ public:
 /**
  The top-level component which houses the other components necessary for recording layers.
  */
-class LayerRecorderComponent : public juce::Component {
+class LayerRecorderComponent : public juce::Component, private juce::Timer {
 public:
     /**
      Create a new LayerRecorderComponent
@@ -168,10 +470,11 @@ public:
     void setProject(Project* p);
     
     /**
-     Sets the transport source to reference so that the start time of a layer recording relative to it's project's mixdown can be saved.
+     Sets the transport source to play the mixdown from. The recorder renders it in its own audio callback, so that
+     each layer's start relative to its project's mixdown is exact to the sample.
      This is admittedly bad practice, and indicative of architectural flaws.
      */
-    void setTransport(juce::AudioTransportSource*);
+    void setTransport(PlaybackTransport*);
     void setPlaybackComp(MixdownFolderComp*);
     
     void startRecording();
@@ -180,6 +483,19 @@ public:
     bool isRecording() { return isCurrentlyRecording; }
     
 private:
+    /** Polls the recorder's disk writer counters while recording and warns when audio is being lost, or
+        waits for a latency calibration to finish. */
+    void timerCallback() override;
+    void showWriterStats();
+    
+    /** Let the user tick which of the device's inputs the next take records. */
+    void showInputMenu();
+    void updateInputButtonText();
+    
+    /** Measure the device's round-trip latency through a loopback cable, and compensate by it from then on. */
+    void startCalibration();
+    void finishCalibration();
+    
     juce::AudioDeviceManager& audioDeviceManager;
     
     LiveScrollingAudioDisplay liveAudioScroller;
@@ -188,12 +504,23 @@ private:
     
     juce::Label explanationLabel { {}, "No project loaded"};
     juce::TextButton recordButton { "Record" };
+    juce::TextButton inputsButton;       // which inputs to record
+    juce::Array<int> selectedInputs { 0 }; // indices into the device's active inputs, in ascending order
+    juce::ComboBox captureModeBox;       // how to lay the inputs out in layers
+    juce::ComboBox formatBox;      // bit depth of recorded layers
+    juce::ToggleButton preRollToggle { "Pre-roll" }; // start takes a few seconds before Record is pressed
+    juce::ToggleButton latencyToggle { "Compensate latency" };
+    juce::ToggleButton cycleToggle { "Cycle" }; // while playback loops, record each pass as new layers
+    juce::ComboBox splitBox;       // when long takes move on to a new layer file
+    juce::ComboBox diskBufferBox;  // how long a disk stall takes ride out before spilling
+    juce::TextButton calibrateButton { "Calibrate latency" };
+    std::unique_ptr<LatencyCalibrator> calibrator; // only while a calibration is running
     
     bool isCurrentlyRecording;
     
     MixdownFolderComp* playbackComp;
     Project* currProject; // The Project which this LayerRecorderComponent is currently recording layers to
-    juce::AudioTransportSource* transport;
+    PlaybackTransport* transport;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LayerRecorderComponent)
 };
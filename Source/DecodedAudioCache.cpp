@@ -0,0 +1,182 @@
+/*
+  ==============================================================================
+
+    DecodedAudioCache.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "DecodedAudioCache.h"
+
+
+//===================================== DecodeJob =========================================
+
+/** Decodes one file into the cache. */
+class DecodedAudioCache::DecodeJob : public juce::ThreadPoolJob {
+public:
+    DecodeJob(DecodedAudioCache& c, const juce::File& f, double rate, const juce::String& k)
+        : ThreadPoolJob("decode " + f.getFileName()), cache(c), file(f), sampleRate(rate), key(k) {}
+
+    JobStatus runJob() override {
+        decode();
+
+        const juce::ScopedLock sl (cache.lock);
+        cache.pending.removeString(key);
+        return jobHasFinished;
+    }
+
+private:
+    void decode() {
+        std::unique_ptr<juce::AudioFormatReader> reader (cache.formatManager.createReaderFor(file));
+        if (reader == nullptr || reader->lengthInSamples <= 0) return;
+
+        // Anything taking more than a quarter of the budget would push too much else out
+        const double stretch = sampleRate > 0.0 ? juce::jmax(1.0, sampleRate / reader->sampleRate) : 1.0;
+        const auto size = (juce::uint64) (reader->lengthInSamples * stretch) * reader->numChannels * sizeof (float);
+        if (size > cache.getMemoryBudget() / 4 || reader->lengthInSamples > std::numeric_limits<int>::max()) return;
+
+        auto audio = std::make_shared<DecodedAudio>();
+        audio->sampleRate = reader->sampleRate;
+        audio->samples.setSize((int) reader->numChannels, (int) reader->lengthInSamples);
+
+        // In pieces, so that shutting down doesn't wait on a whole file
+        const int chunk = 65536;
+        for (juce::int64 pos = 0; pos < reader->lengthInSamples; pos += chunk) {
+            if (shouldExit()) return;
+            const int num = (int) juce::jmin((juce::int64) chunk, reader->lengthInSamples - pos);
+            reader->read(&audio->samples, (int) pos, num, pos, true, true);
+        }
+
+        if (sampleRate > 0.0 && sampleRate != reader->sampleRate) {
+            audio->samples = resampleBuffer(audio->samples, reader->sampleRate, sampleRate, [this] { return shouldExit(); });
+            if (audio->samples.getNumSamples() == 0) return;
+            audio->sampleRate = sampleRate;
+        }
+
+        cache.add(key, std::move(audio));
+    }
+
+    DecodedAudioCache& cache;
+    const juce::File file;
+    const double sampleRate;
+    const juce::String key;
+
+    JUCE_DECLARE_NON_COPYABLE (DecodeJob)
+};
+
+
+//===================================== DecodedAudioCache =========================================
+
+DecodedAudioCache::DecodedAudioCache() {
+    formatManager.registerBasicFormats();
+}
+
+DecodedAudioCache::~DecodedAudioCache() {
+    pool.removeAllJobs(true, -1);
+}
+
+juce::String DecodedAudioCache::getKey(const juce::File& file, double sampleRate) {
+    auto key = file.getFullPathName() + "|" + juce::String(file.getLastModificationTime().toMilliseconds());
+    return sampleRate > 0.0 ? key + "@" + juce::String(sampleRate) : key;
+}
+
+std::shared_ptr<const DecodedAudio> DecodedAudioCache::find(const juce::File& file, double sampleRate) {
+    const auto key = getKey(file, sampleRate);
+    const juce::ScopedLock sl (lock);
+
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries.getReference(i).key == key) {
+            entries.move(i, 0);
+            ++hits;
+            return entries.getReference(0).audio;
+        }
+    }
+
+    ++misses;
+    return nullptr;
+}
+
+void DecodedAudioCache::decodeInBackground(const juce::File& file, double sampleRate) {
+    const auto key = getKey(file, sampleRate);
+
+    {
+        const juce::ScopedLock sl (lock);
+        if (pending.contains(key)) return;
+        for (auto& entry : entries)
+            if (entry.key == key) return;
+        pending.add(key);
+    }
+
+    pool.addJob(new DecodeJob(*this, file, sampleRate, key), true);
+}
+
+void DecodedAudioCache::add(const juce::String& key, std::shared_ptr<const DecodedAudio> audio) {
+    const juce::ScopedLock sl (lock);
+
+    // Any older copy of the same file is stale now, as is one at another rate
+    const auto path = key.upToLastOccurrenceOf("|", true, false);
+    for (int i = entries.size(); --i >= 0;) {
+        if (entries.getReference(i).key.startsWith(path)) {
+            bytesUsed -= entries.getReference(i).audio->getSizeInBytes();
+            entries.remove(i);
+        }
+    }
+
+    bytesUsed += audio->getSizeInBytes();
+    entries.insert(0, { key, std::move(audio) });
+    trimToBudget();
+}
+
+void DecodedAudioCache::trimToBudget() {
+    while (bytesUsed > budget && ! entries.isEmpty()) {
+        bytesUsed -= entries.getLast().audio->getSizeInBytes();
+        entries.removeLast();
+    }
+}
+
+void DecodedAudioCache::setMemoryBudget(size_t bytes) {
+    const juce::ScopedLock sl (lock);
+    budget = bytes;
+    trimToBudget();
+}
+
+size_t DecodedAudioCache::getMemoryBudget() const {
+    const juce::ScopedLock sl (lock);
+    return budget;
+}
+
+DecodedAudioCache::Stats DecodedAudioCache::getStats() const {
+    const juce::ScopedLock sl (lock);
+
+    Stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.numEntries = entries.size();
+    stats.bytesUsed = bytesUsed;
+    return stats;
+}
+
+
+//===================================== CachedAudioSource =========================================
+
+CachedAudioSource::CachedAudioSource(std::shared_ptr<const DecodedAudio> a) : audio(std::move(a)) {}
+
+void CachedAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    auto start = position.load();
+    bufferToFill.clearActiveBufferRegion();
+
+    const auto& samples = audio->samples;
+    const int numSourceChannels = samples.getNumChannels();
+    const auto from = juce::jmax((juce::int64) 0, start);
+    const auto to = juce::jmin((juce::int64) samples.getNumSamples(), start + bufferToFill.numSamples);
+
+    if (to > from && numSourceChannels > 0)
+        for (int ch = 0; ch < bufferToFill.buffer->getNumChannels(); ++ch)
+            bufferToFill.buffer->copyFrom(ch, bufferToFill.startSample + (int) (from - start), samples,
+                                          ch % numSourceChannels, (int) from, (int) (to - from));
+
+    // If another thread seeked while we were reading, its position wins
+    position.compare_exchange_strong(start, start + bufferToFill.numSamples);
+}
@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    DecodedAudioCache.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Keeps recently played audio decoded in memory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SincResampler.h"
+
+
+/** A whole file's audio, decoded into memory. */
+struct DecodedAudio {
+    juce::AudioBuffer<float> samples;
+    double sampleRate = 0.0;
+
+    size_t getSizeInBytes() const noexcept {
+        return (size_t) samples.getNumChannels() * (size_t) samples.getNumSamples() * sizeof (float);
+    }
+};
+
+
+/**
+ A memory-budgeted, least-recently-used cache of decoded audio files, keyed by path and modification time,
+ so editing a file on disk makes its cached copy stale.
+
+ Files are decoded on the cache's own background thread when asked for, and played back from memory through
+ a CachedAudioSource the next time they're opened. One cache is shared by everything that plays audio, through
+ a juce::SharedResourcePointer. It is thread-safe.
+
+ Cached audio is handed out as shared pointers, so an entry that's evicted while it's still playing stays
+ alive until playback lets go of it; only what the cache itself holds counts towards the budget.
+ */
+class DecodedAudioCache {
+public:
+    DecodedAudioCache();
+    ~DecodedAudioCache();
+
+    /**
+     Look up a file's decoded audio, marking it as recently used. Counts towards the hit rate.
+     @param sampleRate  The rate it was resampled to ahead of time, or 0 for the file's own.
+     @return    The audio, or nullptr if the file isn't cached (at that rate) or has changed since it was.
+     */
+    std::shared_ptr<const DecodedAudio> find(const juce::File& file, double sampleRate = 0.0);
+
+    /**
+     Decode a file into the cache on a background thread, unless it's already cached or on its way. Files too
+     large to be worth a good part of the budget are left out. Only one copy of a file is kept, so decoding it
+     at a new rate replaces any other.
+     @param sampleRate  A rate to resample it to (at the best quality), or 0 to keep the file's own.
+     */
+    void decodeInBackground(const juce::File& file, double sampleRate = 0.0);
+
+    /** Set how much decoded audio the cache may hold, evicting what's been least recently used to fit. */
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const;
+
+    /** How well the cache is doing. */
+    struct Stats {
+        int hits = 0, misses = 0;
+        int numEntries = 0;
+        size_t bytesUsed = 0;
+
+        double getHitRate() const noexcept { return hits + misses > 0 ? (double) hits / (hits + misses) : 0.0; }
+    };
+
+    Stats getStats() const;
+
+    static constexpr size_t defaultMemoryBudget = (size_t) 512 * 1024 * 1024;
+
+private:
+    struct Entry {
+        juce::String key;
+        std::shared_ptr<const DecodedAudio> audio;
+    };
+
+    class DecodeJob;
+
+    static juce::String getKey(const juce::File& file, double sampleRate);
+    void add(const juce::String& key, std::shared_ptr<const DecodedAudio> audio);
+    void trimToBudget(); // with the lock held
+
+    mutable juce::CriticalSection lock;
+    juce::Array<Entry> entries; // most recently used first
+    juce::StringArray pending;  // being decoded
+    size_t budget = defaultMemoryBudget, bytesUsed = 0;
+    int hits = 0, misses = 0;
+
+    juce::AudioFormatManager formatManager;
+    juce::ThreadPool pool { 1 };
+
+    JUCE_DECLARE_NON_COPYABLE (DecodedAudioCache)
+};
+
+
+/**
+ A PositionableAudioSource that plays audio straight from a DecodedAudioCache entry. Source channels repeat
+ across any extra output channels.
+ */
+class CachedAudioSource : public juce::PositionableAudioSource {
+public:
+    explicit CachedAudioSource(std::shared_ptr<const DecodedAudio> audio);
+
+    void prepareToPlay(int, double) override {}
+    void releaseResources() override {}
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override { position = newPosition; }
+    juce::int64 getNextReadPosition() const override { return position.load(); }
+    juce::int64 getTotalLength() const override { return audio->samples.getNumSamples(); }
+    bool isLooping() const override { return false; }
+
+private:
+    std::shared_ptr<const DecodedAudio> audio;
+    std::atomic<juce::int64> position { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (CachedAudioSource)
+};
@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    LatencyCalibration.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "LatencyCalibration.h"
+
+
+//===================================== LatencyCalibrator =========================================
+
+LatencyCalibrator::LatencyCalibrator(int channel) : inputChannel(channel) {}
+
+void LatencyCalibrator::audioDeviceAboutToStart(juce::AudioIODevice* device) {
+    const double sampleRate = device->getCurrentSampleRate();
+
+    // A few impulses at uneven spacing, so a stray click or an echo can't line up with all of them
+    impulsePositions.clearQuick();
+    for (double time : { 0.1, 0.35, 0.7, 1.15 })
+        impulsePositions.add((int) (time * sampleRate));
+
+    maxLatency = (int) (0.5 * sampleRate);
+    recorded.setSize(1, impulsePositions.getLast() + maxLatency + 1);
+    recorded.clear();
+    position = 0;
+    finished = false;
+}
+
+void LatencyCalibrator::audioDeviceIOCallback(const float** inputChannelData, int numInputChannels,
+                                              float** outputChannelData, int numOutputChannels,
+                                              int numSamples) {
+    for (int i = 0; i < numOutputChannels; ++i)
+        if (outputChannelData[i] != nullptr)
+            juce::FloatVectorOperations::clear(outputChannelData[i], numSamples);
+
+    const int numToDo = juce::jmin(numSamples, recorded.getNumSamples() - position);
+    if (numToDo <= 0) return;
+
+    for (int pos : impulsePositions) {
+        if (pos >= position && pos < position + numToDo)
+            for (int i = 0; i < numOutputChannels; ++i)
+                if (outputChannelData[i] != nullptr)
+                    outputChannelData[i][pos - position] = impulseLevel;
+    }
+
+    if (inputChannel < numInputChannels && inputChannelData[inputChannel] != nullptr)
+        recorded.copyFrom(0, position, inputChannelData[inputChannel], numToDo);
+
+    position += numToDo;
+    if (position == recorded.getNumSamples())
+        finished = true;
+}
+
+int LatencyCalibrator::computeLatency() const {
+    if (! isFinished() || impulsePositions.isEmpty()) return -1;
+
+    // The test signal is zero except at the impulses, so each lag of the cross-correlation only needs the
+    // recorded samples that line up with them. Polarity may be inverted along the way, hence the abs().
+    const float* input = recorded.getReadPointer(0);
+    int bestLag = -1;
+    float best = 0.0f, total = 0.0f;
+
+    for (int lag = 0; lag <= maxLatency; ++lag) {
+        float correlation = 0.0f;
+        for (int pos : impulsePositions)
+            correlation += input[pos + lag] * impulseLevel;
+
+        correlation = std::abs(correlation);
+        total += correlation;
+        if (correlation > best) {
+            best = correlation;
+            bestLag = lag;
+        }
+    }
+
+    // Demand a peak that stands well clear of the rest; otherwise it's just noise
+    const float mean = total / (float) (maxLatency + 1);
+    const float minimumPeak = 0.01f * impulseLevel * (float) impulsePositions.size();
+    if (best < minimumPeak || best < 8.0f * mean) return -1;
+
+    return bestLag;
+}
+
+juce::String LatencyCalibrator::getDeviceKey(juce::AudioIODevice& device) {
+    // The round trip depends on the buffer size and sample rate as well as the device itself
+    return "latency_" + device.getTypeName() + "_" + device.getName()
+           + "_" + juce::String(device.getCurrentSampleRate()) + "_" + juce::String(device.getCurrentBufferSizeSamples());
+}
+
+static juce::PropertiesFile::Options getSettingsOptions() {
+    juce::PropertiesFile::Options options;
+    options.applicationName = "Spark";
+    options.filenameSuffix = ".settings";
+    options.folderName = "Spark";
+    options.osxLibrarySubFolder = "Application Support";
+    return options;
+}
+
+int LatencyCalibrator::getStoredLatency(juce::AudioIODevice& device) {
+    juce::PropertiesFile settings (getSettingsOptions());
+    return settings.getIntValue(getDeviceKey(device), -1);
+}
+
+void LatencyCalibrator::storeLatency(juce::AudioIODevice& device, int latencySamples) {
+    juce::PropertiesFile settings (getSettingsOptions());
+    settings.setValue(getDeviceKey(device), latencySamples);
+    settings.saveIfNeeded();
+}
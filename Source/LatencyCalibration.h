@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    LatencyCalibration.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Measures an audio device's true round-trip latency through a loopback
+    connection, and remembers the result for each device.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+
+/**
+ Plays a short train of impulses on every output and records one input, so that with the outputs looped back
+ into that input, the delay between the two is the device's real round-trip latency. The driver-reported
+ figures from AudioIODevice often leave out converter and interface delays.
+
+ Add it to an AudioDeviceManager as a callback; once isFinished() returns true, remove it and call
+ computeLatency(). Output and input are handled in the same callback, so the measurement uses the device's
+ own sample clock.
+ */
+class LatencyCalibrator : public juce::AudioIODeviceCallback {
+public:
+    /**
+     @param inputChannel    Index of the active input channel the outputs are looped back into.
+     */
+    explicit LatencyCalibrator(int inputChannel = 0);
+
+    /**
+     True once the whole test signal has been played and the input after it recorded.
+     */
+    bool isFinished() const noexcept { return finished.load(); }
+
+    /**
+     Cross-correlate the recorded input with the test signal.
+     @return    The round-trip latency in samples, or -1 if the test signal couldn't be found clearly in the
+                input (usually because nothing is looped back).
+     */
+    int computeLatency() const;
+
+    /**
+     Look up the latency last calibrated for a device in its current configuration.
+     @return    The latency in samples, or -1 if it has never been calibrated.
+     */
+    static int getStoredLatency(juce::AudioIODevice& device);
+
+    /**
+     Remember a calibrated latency for a device in its current configuration, across sessions.
+     */
+    static void storeLatency(juce::AudioIODevice& device, int latencySamples);
+
+    void audioDeviceAboutToStart(juce::AudioIODevice* device) override;
+    void audioDeviceStopped() override {}
+    void audioDeviceIOCallback(const float** inputChannelData, int numInputChannels,
+                               float** outputChannelData, int numOutputChannels,
+                               int numSamples) override;
+
+private:
+    static juce::String getDeviceKey(juce::AudioIODevice& device);
+
+    const int inputChannel;
+    juce::Array<int> impulsePositions; // where the test signal is non-zero, in samples from its start
+    float impulseLevel = 0.5f;
+    int maxLatency = 0;                // longest round trip searched for
+
+    juce::AudioBuffer<float> recorded;
+    int position = 0;                  // only touched by the audio thread
+    std::atomic<bool> finished { false };
+
+    JUCE_DECLARE_NON_COPYABLE (LatencyCalibrator)
+};
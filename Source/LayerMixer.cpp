@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    LayerMixer.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "LayerMixer.h"
+
+
+//===================================== LayerStrip =========================================
+
+LayerMixerComponent::LayerStrip::LayerStrip(LayerMixerComponent& o, const juce::File& layerFile, const LayerMixSettings& settings)
+    : owner(o), file(layerFile) {
+    addAndMakeVisible(nameLabel);
+    nameLabel.setText(file.getFileNameWithoutExtension(), juce::dontSendNotification);
+
+    addAndMakeVisible(gainSlider);
+    gainSlider.setRange(-60.0, 6.0, 0.1);
+    gainSlider.setTextValueSuffix(" dB");
+    gainSlider.setDoubleClickReturnValue(true, 0.0);
+    gainSlider.setValue(juce::Decibels::gainToDecibels(settings.gain, -60.0f), juce::dontSendNotification);
+    gainSlider.onValueChange = [this] { sendChange(); };
+
+    addAndMakeVisible(panSlider);
+    panSlider.setRange(-1.0, 1.0, 0.01);
+    panSlider.setDoubleClickReturnValue(true, 0.0);
+    panSlider.setValue(settings.pan, juce::dontSendNotification);
+    panSlider.onValueChange = [this] { sendChange(); };
+
+    for (auto* button : { &muteButton, &soloButton }) {
+        addAndMakeVisible(button);
+        button->setClickingTogglesState(true);
+        button->onClick = [this] { sendChange(); };
+    }
+    muteButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::orange);
+    soloButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::yellow.darker());
+    muteButton.setToggleState(settings.mute, juce::dontSendNotification);
+    soloButton.setToggleState(settings.solo, juce::dontSendNotification);
+}
+
+void LayerMixerComponent::LayerStrip::sendChange() {
+    LayerMixSettings settings;
+    settings.gain = gainSlider.getValue() <= gainSlider.getMinimum() ? 0.0f
+                                                                      : juce::Decibels::decibelsToGain((float) gainSlider.getValue());
+    settings.pan = (float) panSlider.getValue();
+    settings.mute = muteButton.getToggleState();
+    settings.solo = soloButton.getToggleState();
+    owner.settingsChanged(file, settings);
+}
+
+void LayerMixerComponent::LayerStrip::resized() {
+    auto area = getLocalBounds().reduced(2);
+    nameLabel .setBounds(area.removeFromLeft(90));
+    soloButton.setBounds(area.removeFromRight(28).reduced(1));
+    muteButton.setBounds(area.removeFromRight(28).reduced(1));
+    panSlider .setBounds(area.removeFromRight(area.getHeight() + 4));
+    gainSlider.setBounds(area);
+}
+
+
+//===================================== LayerMixerComponent =========================================
+
+LayerMixerComponent::LayerMixerComponent() {
+    addAndMakeVisible(viewport);
+    viewport.setViewedComponent(&stripHolder, false);
+    viewport.setScrollBarsShown(true, false);
+}
+
+LayerMixerComponent::~LayerMixerComponent() {
+    saveMix();
+}
+
+void LayerMixerComponent::setProject(Project* newProject, ProjectMixSource* mixSource) {
+    if (newProject != project) saveMix();
+
+    project = newProject;
+    mix = mixSource;
+    strips.clear();
+
+    if (project != nullptr) {
+        auto& mixer = project->getMixer();
+        for (auto& layer : project->layers) {
+            auto* strip = strips.add(new LayerStrip(*this, layer.getFile(), mixer.getSettings(layer.getFile())));
+            stripHolder.addAndMakeVisible(strip);
+        }
+    }
+
+    resized();
+}
+
+void LayerMixerComponent::settingsChanged(const juce::File& layerFile, const LayerMixSettings& settings) {
+    if (project == nullptr) return;
+
+    project->getMixer().setSettings(layerFile, settings);
+    if (mix != nullptr) mix->updateMix(*project);
+    if (onMixChanged != nullptr) onMixChanged();
+
+    // Saving waits until the controls have been left alone for a moment
+    startTimer(1000);
+}
+
+void LayerMixerComponent::saveMix() {
+    stopTimer();
+    if (project != nullptr) project->getMixer().save();
+}
+
+void LayerMixerComponent::resized() {
+    viewport.setBounds(getLocalBounds());
+
+    const int width = viewport.getMaximumVisibleWidth();
+    stripHolder.setSize(width, strips.size() * stripHeight);
+
+    for (int i = 0; i < strips.size(); ++i)
+        strips.getUnchecked(i)->setBounds(0, i * stripHeight, width, stripHeight);
+}
@@ -0,0 +1,77 @@
+/*
+  ==============================================================================
+
+    LayerMixer.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Controls for auditioning a project's layers against its mixdown.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectManagement.h"
+#include "ProjectMixSource.h"
+
+
+/**
+ A scrolling list of a project's layers, each with gain, pan, mute and solo controls. Changes go straight to
+ the project's ProjectMixer and on to playback, and are saved to disk shortly after the last one.
+ */
+class LayerMixerComponent : public juce::Component, private juce::Timer {
+public:
+    LayerMixerComponent();
+    ~LayerMixerComponent() override;
+
+    /**
+     Show the layers of a project, whose mix is playing through mixSource. Any unsaved changes to the
+     previous project are saved first.
+     @param project     The project to show, or nullptr to show nothing.
+     @param mixSource   The source playing the project, if any.
+     */
+    void setProject(Project* project, ProjectMixSource* mixSource);
+
+    /** Called whenever a layer's settings change, once the mix has been updated. */
+    std::function<void()> onMixChanged;
+
+    void resized() override;
+
+private:
+    /** The controls for one layer. */
+    class LayerStrip : public juce::Component {
+    public:
+        LayerStrip(LayerMixerComponent& owner, const juce::File& layerFile, const LayerMixSettings& settings);
+        void resized() override;
+
+    private:
+        void sendChange();
+
+        LayerMixerComponent& owner;
+        const juce::File file;
+
+        juce::Label nameLabel;
+        juce::Slider gainSlider { juce::Slider::LinearHorizontal, juce::Slider::TextBoxRight };
+        juce::Slider panSlider { juce::Slider::RotaryHorizontalVerticalDrag, juce::Slider::NoTextBox };
+        juce::TextButton muteButton { "M" }, soloButton { "S" };
+
+        JUCE_DECLARE_NON_COPYABLE (LayerStrip)
+    };
+
+    void settingsChanged(const juce::File& layerFile, const LayerMixSettings& settings);
+    void saveMix();
+    void timerCallback() override { saveMix(); }
+
+    Project* project = nullptr;
+    ProjectMixSource* mix = nullptr;
+
+    juce::Viewport viewport;
+    juce::Component stripHolder;
+    juce::OwnedArray<LayerStrip> strips;
+
+    static constexpr int stripHeight = 32;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LayerMixerComponent)
+};
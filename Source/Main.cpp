@@ -9,6 +9,9 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "ProjectBounce.h"
+#include "SincResampler.h"
+#include "SampleConversion.h"
 
 //==============================================================================
 class SparkApplication  : public juce::JUCEApplication
@@ -41,6 +44,33 @@ public:
     //==============================================================================
     void initialise (const juce::String& commandLine) override
     {
+        // Renders a project's mix without opening a window
+        auto args = juce::StringArray::fromTokens (commandLine, true);
+        if (args.contains ("--bounce"))
+        {
+            setApplicationReturnValue (runBounce (args));
+            quit();
+            return;
+        }
+
+        // Compares the CPU each resampling quality takes
+        if (args.contains ("--benchmark-resampling"))
+        {
+            for (auto& line : benchmarkResampling())
+                std::cout << line << std::endl;
+            quit();
+            return;
+        }
+
+        // Compares the dither kernel recording uses with a plain loop
+        if (args.contains ("--benchmark-conversion"))
+        {
+            for (auto& line : benchmarkConversion())
+                std::cout << line << std::endl;
+            quit();
+            return;
+        }
+
         // Initializes the spark application
 
         mainWindow.reset (new MainWindow (getApplicationName()));
@@ -114,6 +144,46 @@ public:
 
 private:
     std::unique_ptr<MainWindow> mainWindow;
+
+    /**
+    * Renders a project's mixdown and layers to a file, for the --bounce command line option.
+    *
+    * @param args  The command line, containing "--bounce <mixdown file> <output .wav or .flac file>".
+    * @return int  The exit code for the application.
+    */
+    int runBounce (const juce::StringArray& args)
+    {
+        const int index = args.indexOf ("--bounce");
+        if (index + 2 >= args.size())
+        {
+            std::cerr << "Usage: Spark --bounce <mixdown file> <output .wav or .flac file>" << std::endl;
+            return 1;
+        }
+
+        auto workingDirectory = juce::File::getCurrentWorkingDirectory();
+        auto mixdownFile = workingDirectory.getChildFile (args[index + 1].unquoted());
+        auto outputFile = workingDirectory.getChildFile (args[index + 2].unquoted());
+
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        try
+        {
+            Project project (mixdownFile);
+            ProjectBouncer bouncer (formatManager);
+            auto stats = bouncer.bounce (project, outputFile);
+
+            std::cout << "Bounced " << juce::String (stats.audioSeconds, 1) << " s of " << project.getName()
+                      << " to " << outputFile.getFullPathName() << " in " << juce::String (stats.renderSeconds, 2)
+                      << " s (" << juce::String (stats.getSpeed(), 1) << "x real time)" << std::endl;
+            return 0;
+        }
+        catch (const char* error)
+        {
+            std::cerr << "Bounce failed: " << error << std::endl;
+            return 1;
+        }
+    }
 };
 
 //==============================================================================
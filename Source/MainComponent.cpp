@@ -29,7 +29,7 @@ MainComponent::MainComponent()
     addAndMakeVisible(mixdownFolderComp);
     //mixdownFolderComp.addMouseListener(this, true); // not sure if necessary...
         
-    setSize (1000, 500);
+    setSize (1000, 700);
             
     //addAndMakeVisible(diagnosticsBox);
     diagnosticsBox.setMultiLine (true);
@@ -111,8 +111,8 @@ void MainComponent::resized() {
 * @param samplesPerBlockExpected  Number of samples per block to be loaded in.
 * @param sampleRate  Expected sample rate of files.
 */
-void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
-    mixdownFolderComp.prepareToPlay(samplesPerBlockExpected, sampleRate);
+void MainComponent::prepareToPlay(int, double) {
+    // The mixdown transport is prepared by the layer recorder, which renders it (see getNextAudioBlock())
 }
 
 /**
@@ -122,8 +122,9 @@ void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate
 *   AudioSourceChannelInfo object.
 */
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
-    //bufferToFill.clearActiveBufferRegion(); // prevent feedback
-    mixdownFolderComp.getNextAudioBlock(bufferToFill);
+    // Playback is rendered in the layer recorder's audio callback rather than here, so that recording and
+    // playback share one sample clock and layers line up with the mixdown exactly
+    bufferToFill.clearActiveBufferRegion(); // prevent feedback
 }
 
 /**
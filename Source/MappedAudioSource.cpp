@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    MappedAudioSource.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "MappedAudioSource.h"
+
+
+//===================================== MappedAudioSource =========================================
+
+std::unique_ptr<MappedAudioSource> MappedAudioSource::create(const juce::File& file, juce::AudioFormatManager& formatManager,
+                                                             juce::TimeSliceThread& prefetchThread) {
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+    if (format == nullptr) return nullptr;
+
+    // Formats that can't be mapped (the compressed ones) give back nothing here
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader (format->createMemoryMappedReader(file));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || ! reader->mapEntireFile()) return nullptr;
+
+    // A file cut short of what its header claims can't be read past the end of the mapping
+    if (reader->getMappedSection().getEnd() < reader->lengthInSamples) return nullptr;
+
+    return std::unique_ptr<MappedAudioSource> (new MappedAudioSource(std::move(reader), prefetchThread));
+}
+
+MappedAudioSource::MappedAudioSource(std::unique_ptr<juce::MemoryMappedAudioFormatReader> r, juce::TimeSliceThread& prefetchThread)
+    : reader(std::move(r)), thread(prefetchThread) {
+    const int bytesPerFrame = juce::jmax(1, (int) reader->numChannels * (int) reader->bitsPerSample / 8);
+    samplesPerPage = juce::jmax(1, 4096 / bytesPerFrame);
+}
+
+MappedAudioSource::~MappedAudioSource() {
+    thread.removeTimeSliceClient(this);
+}
+
+void MappedAudioSource::prefetchAround(juce::int64 newPosition) const {
+    touchRange(newPosition, newPosition + (juce::int64) (seekPrefetchSeconds * reader->sampleRate));
+}
+
+void MappedAudioSource::touchRange(juce::int64 start, juce::int64 end) const {
+    start = juce::jmax((juce::int64) 0, start);
+    end = juce::jmin(reader->lengthInSamples, end);
+
+    for (auto sample = start; sample < end; sample += samplesPerPage)
+        reader->touchSample(sample);
+}
+
+int MappedAudioSource::useTimeSlice() {
+    const auto playhead = juce::jmax((juce::int64) 0, position.load());
+    const auto end = juce::jmin(reader->lengthInSamples, playhead + (juce::int64) (prefetchSeconds * reader->sampleRate));
+
+    // After a seek, start paging in from the new position
+    if (playhead < prefetchStart || playhead > prefetchEnd)
+        prefetchEnd = playhead;
+
+    if (prefetchEnd < end) {
+        touchRange(prefetchEnd, end);
+        prefetchEnd = end;
+    }
+
+    prefetchStart = playhead;
+    return 20;
+}
+
+//==============================================================================
+void MappedAudioSource::prepareToPlay(int, double) {
+    thread.addTimeSliceClient(this);
+}
+
+void MappedAudioSource::releaseResources() {
+    thread.removeTimeSliceClient(this);
+}
+
+void MappedAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    auto start = position.load();
+
+    // Samples are converted straight from the mapping; anything outside the file comes back as silence
+    reader->read(bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples, start, true, true);
+
+    // If another thread seeked while we were reading, its position wins
+    position.compare_exchange_strong(start, start + bufferToFill.numSamples);
+}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    MappedAudioSource.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Playback of uncompressed audio files straight from memory-mapped storage.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeSync.h"
+
+
+/**
+ A PositionableAudioSource that plays an uncompressed file (WAV, AIFF) through a MemoryMappedAudioFormatReader.
+ Samples are converted straight out of the mapping into the output buffer, with no read-ahead buffer in
+ between, so seeking costs nothing.
+
+ To keep the audio thread from waiting on page faults, the pages ahead of the playhead are touched on a
+ background thread while playing, and prefetchAround() can fault in the pages at a new position before a
+ seek takes effect.
+ */
+class MappedAudioSource : public juce::PositionableAudioSource, public PrefetchableSource,
+                          private juce::TimeSliceClient {
+public:
+    /**
+     Map a file for playback.
+     @param file            The file to play.
+     @param formatManager   Used to find the file's format.
+     @param prefetchThread  The thread that pages in audio ahead of the playhead.
+     @return    The source, or nullptr if the file's format can't be memory-mapped (such as a compressed one)
+                or the file couldn't be mapped, in which case it should be read the usual way.
+     */
+    static std::unique_ptr<MappedAudioSource> create(const juce::File& file, juce::AudioFormatManager& formatManager,
+                                                     juce::TimeSliceThread& prefetchThread);
+    ~MappedAudioSource() override;
+
+    /** The reader, for the file's sample rate, length and channel count. */
+    const juce::AudioFormatReader& getReader() const noexcept { return *reader; }
+
+    /**
+     Page in the audio just after a position, so that playing from there won't touch the disk. This blocks,
+     so it's meant for the thread that's about to seek.
+     */
+    void prefetchAround(juce::int64 position) const;
+
+    void prefetchAt(juce::int64 position) override { prefetchAround(position); }
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override { position = newPosition; }
+    juce::int64 getNextReadPosition() const override { return position.load(); }
+    juce::int64 getTotalLength() const override { return reader->lengthInSamples; }
+    bool isLooping() const override { return false; }
+
+private:
+    MappedAudioSource(std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader, juce::TimeSliceThread& prefetchThread);
+
+    int useTimeSlice() override;
+    void touchRange(juce::int64 start, juce::int64 end) const;
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader;
+    juce::TimeSliceThread& thread;
+    std::atomic<juce::int64> position { 0 };
+
+    // Only touched by the prefetch thread
+    juce::int64 prefetchStart = 0, prefetchEnd = 0;
+
+    int samplesPerPage = 1;
+    static constexpr double prefetchSeconds = 2.0;   // how far ahead of the playhead is kept paged in
+    static constexpr double seekPrefetchSeconds = 0.25;
+
+    JUCE_DECLARE_NON_COPYABLE (MappedAudioSource)
+};
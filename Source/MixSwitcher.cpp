@@ -0,0 +1,303 @@
+/*
+  ==============================================================================
+
+    MixSwitcher.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "MixSwitcher.h"
+#include "PeakCache.h"
+
+
+//===================================== MixSwitchSource =========================================
+
+MixSwitchSource::~MixSwitchSource() {
+    stopTimer();
+    crossfadeLength = 0;
+    active = nullptr;
+    callbackEpoch.waitForCallbackToFinish();
+}
+
+void MixSwitchSource::switchTo(std::unique_ptr<ProjectMixSource> newMix, double crossfadeSeconds) {
+    const int samplesPerBlock = blockSize.load();
+    const double sampleRate = deviceRate.load();
+
+    if (newMix != nullptr && samplesPerBlock > 0 && ! newMix->isPreparedFor(samplesPerBlock, sampleRate))
+        newMix->prepareToPlay(samplesPerBlock, sampleRate);
+
+    crossfadeLength = (int) (crossfadeSeconds * sampleRate);
+    active = newMix.get();
+
+    // The old mix may still be fading out, so it's only deleted once the audio thread is done with it
+    if (current != nullptr) retired.add(current.release());
+    current = std::move(newMix);
+    if (! retired.isEmpty()) startTimer(250);
+}
+
+void MixSwitchSource::timerCallback() {
+    // Once the callback has finished, the mirrored pointers say everything the audio thread may touch
+    callbackEpoch.waitForCallbackToFinish();
+
+    for (int i = retired.size(); --i >= 0;) {
+        auto* mix = retired.getUnchecked(i);
+        if (mix != playingShared.load() && mix != fadingOutShared.load())
+            retired.remove(i);
+    }
+
+    if (retired.isEmpty()) stopTimer();
+}
+
+//==============================================================================
+void MixSwitchSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    blockSize = samplesPerBlockExpected;
+    deviceRate = sampleRate;
+    fadeBuffer.setSize(maxFadeChannels, samplesPerBlockExpected);
+
+    if (current != nullptr) current->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    for (auto* mix : retired)
+        mix->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void MixSwitchSource::releaseResources() {
+    blockSize = 0;
+    if (current != nullptr) current->releaseResources();
+    for (auto* mix : retired)
+        mix->releaseResources();
+}
+
+void MixSwitchSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    const CallbackEpoch::ScopedCallback inCallback (callbackEpoch);
+
+    auto* next = active.load();
+    if (next != playing) {
+        const int fade = crossfadeLength.load();
+        fadingOut = (fade > 0 && playing != nullptr) ? playing : nullptr;
+        fadeLength = fadeRemaining = fade;
+        playing = next;
+        playingShared = playing;
+        fadingOutShared = fadingOut;
+    }
+
+    if (playing == nullptr) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    playing->getNextAudioBlock(bufferToFill);
+
+    if (fadingOut != nullptr) {
+        auto& buffer = *bufferToFill.buffer;
+        const int numChannels = juce::jmin(buffer.getNumChannels(), fadeBuffer.getNumChannels());
+        const int num = fadeBuffer.getNumSamples() > 0 ? juce::jmin(bufferToFill.numSamples, fadeRemaining) : 0;
+
+        // Blocks can be bigger than the one prepared for, so the old mix is read a fadeBuffer at a time
+        for (int done = 0; done < num;) {
+            const int chunk = juce::jmin(num - done, fadeBuffer.getNumSamples());
+            const int start = bufferToFill.startSample + done;
+            const float from = (float) (fadeLength - fadeRemaining + done) / (float) fadeLength;
+            const float to = (float) (fadeLength - fadeRemaining + done + chunk) / (float) fadeLength;
+
+            // The new mix fades in while the old one, mixed over it, fades out
+            buffer.applyGainRamp(start, chunk, from, to);
+
+            juce::AudioBuffer<float> outgoing (fadeBuffer.getArrayOfWritePointers(), numChannels, chunk);
+            fadingOut->getNextAudioBlock(juce::AudioSourceChannelInfo(outgoing));
+            outgoing.applyGainRamp(0, chunk, 1.0f - from, 1.0f - to);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                buffer.addFrom(ch, start, outgoing, ch, 0, chunk);
+            done += chunk;
+        }
+
+        fadeRemaining = num > 0 ? fadeRemaining - num : 0;
+        if (fadeRemaining == 0) {
+            fadingOut = nullptr;
+            fadingOutShared = nullptr;
+        }
+    }
+}
+
+void MixSwitchSource::setNextReadPosition(juce::int64 newPosition) {
+    // Seeks come from the transport on the audio thread, so the mix about to play is held on to while it's moved
+    const CallbackEpoch::ScopedCallback inCallback (callbackEpoch);
+    if (auto* mix = active.load()) mix->setNextReadPosition(newPosition);
+}
+
+juce::int64 MixSwitchSource::getNextReadPosition() const {
+    auto* mix = active.load();
+    return mix != nullptr ? mix->getNextReadPosition() : 0;
+}
+
+juce::int64 MixSwitchSource::getTotalLength() const {
+    auto* mix = active.load();
+    return mix != nullptr ? mix->getTotalLength() : 0;
+}
+
+
+//===================================== MixPrefetcher =========================================
+
+/** Loads one project's mix, a stage at a time. */
+class MixPrefetcher::LoadJob : public juce::ThreadPoolJob {
+public:
+    LoadJob(MixPrefetcher& prefetcher, Project& p, int deviceBlockSize, double deviceSampleRate)
+        : ThreadPoolJob("load " + p.getName()), project(p), revision(p.getRevision()), snapshot(p),
+          blockSize(deviceBlockSize), sampleRate(deviceSampleRate), options(prefetcher.options), owner(prefetcher) {}
+
+    JobStatus runJob() override {
+        // A reader for the thumbnail comes first, so the waveform can start drawing as soon as possible
+        auto& mixdownFile = snapshot.mixdownFile;
+        thumbnailReader.reset(owner.formatManager.createReaderFor(mixdownFile));
+        thumbnailHash = PeakCache::getHashFor(mixdownFile);
+        thumbnailLoaded = true;
+        owner.triggerAsyncUpdate();
+
+        // Then every file is opened and its header read, and buffering starts
+        if (! shouldExit()) {
+            snapshot.readFiles();
+
+            auto newMix = std::make_unique<ProjectMixSource>(owner.formatManager, owner.thread, options.quality,
+                                                             options.preResample ? sampleRate : 0.0);
+
+            if (newMix->loadProject(snapshot)) {
+                // Prepared just as the transport will, which resamples from the mixdown's rate to the device's
+                if (blockSize > 0 && ! shouldExit()) {
+                    const double ratio = newMix->getSampleRate() / sampleRate;
+                    newMix->prepareToPlay(juce::roundToInt(blockSize * ratio), sampleRate * ratio);
+                }
+                mix = std::move(newMix);
+            }
+        }
+
+        mixLoaded = true;
+        owner.triggerAsyncUpdate();
+        return jobHasFinished;
+    }
+
+    Project& project;   // only compared against; the job itself reads nothing but the snapshot
+    const int revision; // the project's, when the snapshot was taken
+    ProjectMixSource::Snapshot snapshot;
+    const int blockSize;
+    const double sampleRate;
+    const ResamplingOptions options;
+
+    std::unique_ptr<juce::AudioFormatReader> thumbnailReader;
+    juce::int64 thumbnailHash = 0;
+    std::unique_ptr<ProjectMixSource> mix;
+    std::atomic<bool> thumbnailLoaded { false }, mixLoaded { false };
+
+private:
+    MixPrefetcher& owner;
+
+    JUCE_DECLARE_NON_COPYABLE (LoadJob)
+};
+
+MixPrefetcher::MixPrefetcher(juce::AudioFormatManager& manager, juce::TimeSliceThread& readAheadThread)
+    : formatManager(manager), thread(readAheadThread) {}
+
+MixPrefetcher::~MixPrefetcher() {
+    clear();
+}
+
+void MixPrefetcher::load(Project& project, int deviceBlockSize, double deviceSampleRate,
+                         ThumbnailCallback onThumbnailReady, MixCallback onMixReady) {
+    cancelLoad();
+    collectAbandoned();
+
+    requested = findJob(project, deviceBlockSize, deviceSampleRate);
+    if (requested == nullptr) {
+        requested = jobs.add(new LoadJob(*this, project, deviceBlockSize, deviceSampleRate));
+        pool.addJob(requested, false);
+    }
+
+    thumbnailCallback = std::move(onThumbnailReady);
+    mixCallback = std::move(onMixReady);
+    deliver();
+}
+
+void MixPrefetcher::cancelLoad() {
+    // The job itself carries on as a prefetch, until prefetch() decides it isn't wanted
+    requested = nullptr;
+    thumbnailCallback = nullptr;
+    mixCallback = nullptr;
+}
+
+void MixPrefetcher::prefetch(const juce::Array<Project*>& projects, int deviceBlockSize, double deviceSampleRate) {
+    collectAbandoned();
+
+    // Drop the projects no longer wanted, any prepared for other device or resampling settings, and any whose
+    // layers or mix have changed since they were loaded
+    for (int i = jobs.size(); --i >= 0;) {
+        auto* job = jobs.getUnchecked(i);
+        const bool wanted = projects.contains(&job->project) && job->options == options
+                            && job->blockSize == deviceBlockSize && job->sampleRate == deviceSampleRate
+                            && job->revision == job->project.getRevision();
+
+        if (job != requested && ! wanted) abandon(job);
+    }
+
+    for (auto* project : projects)
+        if (findJob(*project, deviceBlockSize, deviceSampleRate) == nullptr)
+            pool.addJob(jobs.add(new LoadJob(*this, *project, deviceBlockSize, deviceSampleRate)), false);
+}
+
+void MixPrefetcher::clear() {
+    cancelLoad();
+    cancelPendingUpdate();
+    pool.removeAllJobs(true, -1);
+    jobs.clear();
+    abandoned.clear();
+}
+
+MixPrefetcher::LoadJob* MixPrefetcher::findJob(Project& project, int deviceBlockSize, double deviceSampleRate) const {
+    for (auto* job : jobs)
+        if (&job->project == &project && job->options == options
+            && job->blockSize == deviceBlockSize && job->sampleRate == deviceSampleRate
+            && job->revision == project.getRevision())
+            return job;
+    return nullptr;
+}
+
+void MixPrefetcher::abandon(LoadJob* job) {
+    // One that's part way through loading is told to stop, and deleted once it has
+    jobs.removeObject(job, false);
+    if (pool.removeJob(job, true, 0)) delete job;
+    else abandoned.add(job);
+}
+
+void MixPrefetcher::collectAbandoned() {
+    for (int i = abandoned.size(); --i >= 0;)
+        if (! pool.contains(abandoned.getUnchecked(i)))
+            abandoned.remove(i);
+}
+
+void MixPrefetcher::deliver() {
+    collectAbandoned();
+
+    auto* job = requested;
+    if (job == nullptr) return;
+
+    if (thumbnailCallback != nullptr && job->thumbnailLoaded) {
+        auto callback = std::move(thumbnailCallback);
+        thumbnailCallback = nullptr;
+        callback(std::move(job->thumbnailReader), job->thumbnailHash);
+
+        // The callback may have moved on to another load
+        if (job != requested) return;
+    }
+
+    if (mixCallback != nullptr && job->mixLoaded) {
+        auto callback = std::move(mixCallback);
+        mixCallback = nullptr;
+        requested = nullptr;
+
+        // It's on its way out of runJob(), so this won't wait long
+        jobs.removeObject(job, false);
+        pool.removeJob(job, false, -1);
+        std::unique_ptr<LoadJob> finished (job);
+
+        callback(std::move(finished->mix));
+    }
+}
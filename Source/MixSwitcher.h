@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    MixSwitcher.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Gapless switching between projects during playback.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectMixSource.h"
+#include "RealtimeSync.h"
+
+
+/**
+ A PositionableAudioSource that plays one ProjectMixSource at a time and can hand over to another without
+ interrupting playback, optionally crossfading between the two.
+
+ The new mix is published to the audio thread wait-free. The outgoing one keeps playing for the length of the
+ crossfade and is deleted on the message thread once the audio thread has let go of it.
+ */
+class MixSwitchSource : public juce::PositionableAudioSource, public PrefetchableSource, private juce::Timer {
+public:
+    MixSwitchSource() = default;
+    ~MixSwitchSource() override;
+
+    /**
+     Make another mix the one that plays, from wherever its read position is. It is prepared first if it
+     hasn't been already for the current device settings.
+     @param newMix              The mix to play, or nullptr to play nothing.
+     @param crossfadeSeconds    How long the old mix fades out as the new one fades in; 0 to cut straight over.
+     */
+    void switchTo(std::unique_ptr<ProjectMixSource> newMix, double crossfadeSeconds);
+
+    /** The mix that is playing, or about to be; nullptr if there is none. */
+    ProjectMixSource* getMix() const noexcept { return current.get(); }
+
+    /** Prefetches the mix that is playing, or about to be. Message thread only. */
+    void prefetchAt(juce::int64 position) override {
+        if (current != nullptr) current->prefetchAt(position);
+    }
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override { return false; }
+
+private:
+    void timerCallback() override;
+
+    // Owned on the message thread
+    std::unique_ptr<ProjectMixSource> current;
+    juce::OwnedArray<ProjectMixSource> retired; // switched away from, but possibly still fading out
+
+    std::atomic<ProjectMixSource*> active { nullptr };
+    std::atomic<int> crossfadeLength { 0 };
+    std::atomic<int> blockSize { 0 };
+    std::atomic<double> deviceRate { 0.0 };
+    CallbackEpoch callbackEpoch;
+
+    // Only touched by the audio thread, though the mixes it's using are mirrored so the message thread knows
+    // which retired ones are safe to delete
+    ProjectMixSource* playing = nullptr;
+    ProjectMixSource* fadingOut = nullptr;
+    int fadeLength = 0, fadeRemaining = 0;
+    juce::AudioBuffer<float> fadeBuffer;
+    std::atomic<ProjectMixSource*> playingShared { nullptr }, fadingOutShared { nullptr };
+
+    static constexpr int maxFadeChannels = 8;
+
+    JUCE_DECLARE_NON_COPYABLE (MixSwitchSource)
+};
+
+
+/**
+ Loads projects' mixes on background threads: the one about to be played, reporting back as each stage of
+ loading finishes, and those likely to be played next (such as the neighbours of the current one), so
+ switching to them doesn't have to wait for the disk.
+ */
+class MixPrefetcher : private juce::AsyncUpdater {
+public:
+    /** Given a reader for the project's mixdown, or nullptr if it can't be read, and its thumbnail hash. */
+    using ThumbnailCallback = std::function<void (std::unique_ptr<juce::AudioFormatReader> reader, juce::int64 hashCode)>;
+
+    /** Given the project's loaded and buffered mix, or nullptr if it can't be loaded. */
+    using MixCallback = std::function<void (std::unique_ptr<ProjectMixSource> mix)>;
+
+    /**
+     @param formatManager   Used to open the mixdowns and layers.
+     @param readAheadThread The thread every loaded mix reads ahead on.
+     */
+    MixPrefetcher(juce::AudioFormatManager& formatManager, juce::TimeSliceThread& readAheadThread);
+    ~MixPrefetcher() override;
+
+    /**
+     Load a project to play, calling back on the message thread as each stage finishes: first with a reader for
+     its thumbnail, then with its mix once every file is open and buffered. If the project was prefetched, the
+     callbacks may happen before this returns. Only the latest load is followed, so starting one cancels the last.
+     The project's files and mix are snapshotted here, and the loading thread only ever reads the snapshot. A
+     project loaded before is reused unless its revision has moved on since.
+     @param project             The project to load. It must stay alive until it's loaded or cancelled.
+     @param deviceBlockSize     The audio device's block size, to prepare the mix with; 0 to leave it unprepared.
+     @param deviceSampleRate    The audio device's sample rate.
+     */
+    void load(Project& project, int deviceBlockSize, double deviceSampleRate,
+              ThumbnailCallback onThumbnailReady, MixCallback onMixReady);
+
+    /** Stop following the current load, if any, so that its callbacks never happen. */
+    void cancelLoad();
+
+    /**
+     Start loading these projects' mixes in the background, at their beginnings, and drop any others that
+     were loaded (apart from one being followed by load()). Projects already loaded or loading are left alone.
+     @param projects            The projects to have ready. They must stay alive until they're dropped.
+     @param deviceBlockSize     The audio device's block size, to prepare the mixes with; 0 to leave them unprepared.
+     @param deviceSampleRate    The audio device's sample rate.
+     */
+    void prefetch(const juce::Array<Project*>& projects, int deviceBlockSize, double deviceSampleRate);
+
+    /** Drop every loaded mix and cancel any load, waiting for those under way. */
+    void clear();
+
+    /**
+     Set how mixes loaded from now on are resampled. Ones already loaded another way are no longer used, and are
+     dropped by the next prefetch().
+     */
+    void setResamplingOptions(const ResamplingOptions& newOptions) { options = newOptions; }
+
+private:
+    class LoadJob;
+
+    LoadJob* findJob(Project& project, int deviceBlockSize, double deviceSampleRate) const;
+    void abandon(LoadJob* job);
+    void collectAbandoned();
+    void deliver();
+    void handleAsyncUpdate() override { deliver(); }
+
+    juce::AudioFormatManager& formatManager;
+    juce::TimeSliceThread& thread;
+    ResamplingOptions options;
+
+    juce::OwnedArray<LoadJob> jobs, abandoned; // abandoned jobs are deleted once they've finished running
+    juce::ThreadPool pool { 2 };
+
+    // The load being followed
+    LoadJob* requested = nullptr;
+    ThumbnailCallback thumbnailCallback;
+    MixCallback mixCallback;
+
+    JUCE_DECLARE_NON_COPYABLE (MixPrefetcher)
+};
@@ -14,6 +14,7 @@
 
 #include <JuceHeader.h>
 #include "MixdownFolder.h"
+#include "ProjectBounce.h"
 
 /**
 * Constructor inherits from Audio device manager and state enumeration
@@ -83,7 +84,81 @@ MixdownFolderComp::MixdownFolderComp(juce::AudioDeviceManager& adm, LayerRecorde
     };
     stopButton.setEnabled(false);
 
-    //Registers the basic format of WAV and RIFF files
+    addAndMakeVisible(&bounceButton);
+    bounceButton.setButtonText("Bounce");
+    //Lambda captures event on button click and calls function
+    bounceButton.onClick = [this] {bounceButtonClickResponse(); };
+    bounceButton.setEnabled(false);
+
+    addAndMakeVisible(&resamplingBox);
+    resamplingBox.addItem("Draft resampling", 1 + (int) ResamplingQuality::draft);
+    resamplingBox.addItem("Standard resampling", 1 + (int) ResamplingQuality::standard);
+    resamplingBox.addItem("Best resampling", 1 + (int) ResamplingQuality::best);
+    resamplingBox.setSelectedId(1 + (int) resamplingOptions.quality, juce::dontSendNotification);
+    resamplingBox.setTooltip("How files at a different sample rate than the audio device are converted as they play");
+    //Lambda captures event on bar change and calls function
+    resamplingBox.onChange = [this] {resamplingChanged(); };
+
+    addAndMakeVisible(&preResampleButton);
+    preResampleButton.setButtonText("Pre-resample");
+    preResampleButton.setTooltip("Resample whole files to the audio device's rate in the background, "
+                                 "for projects loaded from now on");
+    //Lambda captures event on button click and calls function
+    preResampleButton.onClick = [this] {resamplingChanged(); };
+
+    addAndMakeVisible(&loopStartButton);
+    loopStartButton.setButtonText("Loop from here");
+    //Lambda captures event on button click and calls function
+    loopStartButton.onClick = [this] {
+        loopRegion = loopRegion.withStart(transport.getCurrentPosition());
+        if (loopRegion.getLength() < PlaybackTransport::minLoopSeconds)
+            loopRegion = loopRegion.withLength(PlaybackTransport::minLoopSeconds);
+        loopChanged();
+    };
+
+    addAndMakeVisible(&loopEndButton);
+    loopEndButton.setButtonText("Loop to here");
+    //Lambda captures event on button click and calls function
+    loopEndButton.onClick = [this] {
+        loopRegion = loopRegion.withEnd(transport.getCurrentPosition());
+        if (loopRegion.getLength() < PlaybackTransport::minLoopSeconds)
+            loopRegion = loopRegion.withStart(juce::jmax(0.0, loopRegion.getEnd() - PlaybackTransport::minLoopSeconds));
+        loopButton.setToggleState(true, juce::dontSendNotification);
+        loopChanged();
+    };
+
+    addAndMakeVisible(&loopButton);
+    loopButton.setButtonText("Loop");
+    loopButton.setTooltip("Play the region between the loop points over and over");
+    //Lambda captures event on button click and calls function
+    loopButton.onClick = [this] {loopChanged(); };
+
+    addAndMakeVisible(&loopCrossfadeButton);
+    loopCrossfadeButton.setButtonText("Crossfade");
+    loopCrossfadeButton.setTooltip("Fade briefly from the end of the loop into its start, rather than cutting");
+    //Lambda captures event on button click and calls function
+    loopCrossfadeButton.onClick = [this] {loopChanged(); };
+
+    addAndMakeVisible(&cacheStatsLabel);
+    cacheStatsLabel.setJustificationType(juce::Justification::centredRight);
+    cacheStatsLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
+
+    addAndMakeVisible(&cacheBudgetBox);
+    //Item IDs are the budget in megabytes
+    cacheBudgetBox.addItem("256 MB cache", 256);
+    cacheBudgetBox.addItem("512 MB cache", 512);
+    cacheBudgetBox.addItem("1 GB cache", 1024);
+    cacheBudgetBox.addItem("2 GB cache", 2048);
+    cacheBudgetBox.setSelectedId((int) (decodedCache->getMemoryBudget() >> 20), juce::dontSendNotification);
+    cacheBudgetBox.setTooltip("How much memory recently played audio is kept decoded in, for instant switching");
+    //Lambda captures event on box change and calls function
+    cacheBudgetBox.onChange = [this] {cacheBudgetChanged(); };
+
+    addAndMakeVisible(&mixerComp);
+    //What's kept of the loop's start has to be played again once the mix has changed
+    mixerComp.onMixChanged = [this] {transport.invalidateLoopBuffer(); };
+
+    //Registers the basic formats: WAV, AIFF, FLAC, Ogg Vorbis and MP3
     audioFormatManager.registerBasicFormats();
     //Listener for transport source changes
     transport.addChangeListener (this);
@@ -96,6 +171,7 @@ MixdownFolderComp::MixdownFolderComp(juce::AudioDeviceManager& adm, LayerRecorde
 MixdownFolderComp::~MixdownFolderComp() 
 {
     transport.setSource(nullptr);
+    prefetcher.clear();
     tn->removeChangeListener(this);
 }
 
@@ -119,7 +195,7 @@ void MixdownFolderComp::prepareToPlay(int samplesPerBlockExpected, double sample
 */
 void MixdownFolderComp::getNextAudioBlock(const juce::AudioSourceChannelInfo &bufferToFill) {
     //Clear buffer region to fill in new buffer with audio chunks
-    if (reader.get() == nullptr) {
+    if (reader.get() == nullptr && mixSwitcher.getMix() == nullptr) {
         bufferToFill.clearActiveBufferRegion();
         return;
     }
@@ -206,6 +282,17 @@ void MixdownFolderComp::triggerPlayback() {
         playButton.triggerClick();
 }
 
+void MixdownFolderComp::reloadLayers() {
+    auto* mix = mixSwitcher.getMix();
+    if (mix != nullptr && currentProject != nullptr) {
+        ProjectMixSource::Snapshot snapshot (*currentProject);
+        snapshot.readFiles();
+        mix->loadProject(snapshot);
+        mixerComp.setProject(currentProject, mix);
+        transport.invalidateLoopBuffer();
+    }
+}
+
 /**
 * @see MixdownFolder.h
 */
@@ -224,32 +311,30 @@ void MixdownFolderComp::fileBoxMenuChanged() {
     //fileBoxMenu indices starts at 1 but array indices start at 0
     Project& selected = projects.getReference(fileID-1);
     layerRecorder.setProject(&selected);
-    if (layerRecorder.isRecording()) {
-        // continue recording, but for new project
-        layerRecorder.stopRecording();
-        layerRecorder.startRecording();
-    }
-    
-    juce::AudioFormatReader* fileReader = audioFormatManager.createReaderFor(selected.getMixdownFile());
-
-    if (fileReader != nullptr) {
-        std::unique_ptr< juce::AudioFormatReaderSource>
-            tempReader(new juce::AudioFormatReaderSource(fileReader, true));
-
-        //fileReader->sampleRate handles hardware file sample rate match up
-        transport.setSource(tempReader.get(), 0, nullptr, fileReader->sampleRate);
-
-        //audioPositionSlider.setValue(0);
-        //audioPositionSlider.setRange(0, (fileReader->lengthInSamples / fileReader->sampleRate));
-
-        juce::URL* url = new juce::URL(selected.getMixdownFile());
-        juce::URL& url2 = *url;
-        tn->setURL(url2);
-
-        playButton.setEnabled(true);
 
-        reader.reset(tempReader.release());
-    }
+    //Whatever is playing carries on until the new project is ready
+    mixerComp.setProject(nullptr, nullptr);
+    bounceButton.setEnabled(false);
+    currentProject = nullptr;
+    clearLoop();
+    tn->setMessage("Loading " + selected.getName() + "...");
+
+    //The project is opened, its waveform started and its files buffered on background threads, so a slow
+    //disk never holds up the UI. Choosing another project before this one is ready abandons it
+    int blockSize = 0;
+    double sampleRate = 0.0;
+    getDeviceSettings(blockSize, sampleRate);
+
+    prefetcher.load(selected, blockSize, sampleRate,
+        [this, &selected] (std::unique_ptr<juce::AudioFormatReader> thumbnailReader, juce::int64 hashCode) {
+            if (thumbnailReader != nullptr)
+                tn->setReader(thumbnailReader.release(), hashCode);
+            else
+                tn->setMessage("(Unable to read " + selected.getName() + ")");
+        },
+        [this, &selected] (std::unique_ptr<ProjectMixSource> loadedMix) {
+            projectLoaded(selected, std::move(loadedMix));
+        });
 
     //Set bounds of next/prev buttons
     if (fileBoxMenu.getSelectedId() == projects.size()) {
@@ -262,6 +347,114 @@ void MixdownFolderComp::fileBoxMenuChanged() {
         nextButton.setEnabled(true);
         prevButton.setEnabled(true);
     }
+
+    prefetchNeighbours();
+}
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::projectLoaded(Project& selected, std::unique_ptr<ProjectMixSource> tempMix) {
+    //Plays the mixdown together with every layer, each positioned by its start offset. The neighbouring
+    //projects are usually loaded and buffered already, so flipping through them doesn't leave a gap
+    if (tempMix != nullptr) {
+        warnAboutUnplayableLayers(*tempMix);
+        const double rate = tempMix->getSampleRate();
+        tempMix->setNextReadPosition(0);
+
+        if (rate == mixRate) {
+            //The transport carries on as it was, and the new mix takes over from the old one on the audio thread
+            mixSwitcher.switchTo(std::move(tempMix), transport.isPlaying() ? switchCrossfadeSeconds : 0.0);
+            transport.setNextReadPosition(0);
+            transport.invalidateLoopBuffer();
+        } else {
+            //The mix reads ahead itself, so the transport doesn't buffer. The resampler converts from its sample
+            //rate (the mixdown's) to the hardware's, which means starting the transport over
+            const bool wasPlaying = transport.isPlaying();
+            transport.setSource(nullptr);
+            mixSwitcher.switchTo(std::move(tempMix), 0.0);
+            playbackResampler.setInput(&mixSwitcher, rate);
+            transport.setSource(&playbackResampler);
+            mixRate = rate;
+            if (wasPlaying) transport.start();
+        }
+
+        //audioPositionSlider.setValue(0);
+        //audioPositionSlider.setRange(0, (fileReader->lengthInSamples / fileReader->sampleRate));
+
+        playButton.setEnabled(true);
+        bounceButton.setEnabled(true);
+
+        reader.reset();
+        mixerComp.setProject(&selected, mixSwitcher.getMix());
+        currentProject = &selected;
+
+        updateCacheStats();
+    }
+
+    if (layerRecorder.isRecording()) {
+        // continue recording, but for new project
+        layerRecorder.stopRecording();
+        layerRecorder.startRecording();
+    }
+}
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::updateCacheStats() {
+    //Shows whether the memory given to decoded audio is paying off
+    auto stats = decodedCache->getStats();
+    cacheStatsLabel.setText("Cache: " + juce::String(stats.numEntries) + " files, "
+                            + juce::String((int) (stats.bytesUsed >> 20)) + " MB, "
+                            + juce::String(juce::roundToInt(stats.getHitRate() * 100.0)) + "% hits",
+                            juce::dontSendNotification);
+}
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::warnAboutUnplayableLayers(const ProjectMixSource& mix) {
+    //These would otherwise play at the wrong speed, so they're silent until they're converted
+    const auto& unplayable = mix.getUnplayableLayers();
+    if (unplayable.isEmpty())
+        return;
+
+    juce::StringArray names;
+    for (auto& file : unplayable)
+        names.add(file.getFileName());
+
+    juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Layers left out",
+                                           "These layers have a sample rate that can't be converted to the "
+                                           "mixdown's, so they won't be played:\n\n" + names.joinIntoString("\n"));
+}
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::prefetchNeighbours() {
+    juce::Array<Project*> neighbours;
+    const int index = fileBoxMenu.getSelectedId() - 1;
+
+    for (int i : { index + 1, index - 1 })
+        if (juce::isPositiveAndBelow(i, projects.size()))
+            neighbours.add(&projects.getReference(i));
+
+    int blockSize = 0;
+    double sampleRate = 0.0;
+    getDeviceSettings(blockSize, sampleRate);
+    prefetcher.prefetch(neighbours, blockSize, sampleRate);
+}
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::getDeviceSettings(int& blockSize, double& sampleRate) {
+    //Playback is rendered in the recorder's device callback, so mixes are prepared for the device itself
+    if (auto* device = deviceManager.getCurrentAudioDevice()) {
+        blockSize = device->getCurrentBufferSizeSamples();
+        sampleRate = device->getCurrentSampleRate();
+    }
 }
 
 /*
@@ -283,7 +476,11 @@ void MixdownFolderComp::fileButtonClickResponse() {
         myDirectory = fileChooser.getResult();
 
         fileBoxMenu.clear();
-        projects = ProjectManagement::getAllProjectsInFolder(myDirectory);
+        //Nothing may hold on to the old projects once they're replaced
+        prefetcher.clear();
+        mixerComp.setProject(nullptr, nullptr);
+        currentProject = nullptr;
+        projects = ProjectManagement::getAllProjectsInFolder(myDirectory, audioFormatManager);
 
         for (int i = 0; i < projects.size(); i++) {
             //fileBoxMenu indices starts at 1 but array indices start at 0
@@ -301,8 +498,8 @@ void MixdownFolderComp::fileButtonClickResponse() {
 * @see MixdownFolder.h
 */
 void MixdownFolderComp::nextButtonClickResponse() {
-    TransportState lastState = state;
-    if (state != Stopped) {
+    //While playing, the next project takes over without a gap; otherwise it's ready to play from the start
+    if (state != Playing && state != Stopped) {
         stateChange(Stopped);
     }
 
@@ -318,18 +515,14 @@ void MixdownFolderComp::nextButtonClickResponse() {
         nextButton.setEnabled(true);
         prevButton.setEnabled(true);
     }
-    
-    // Continue playing (begin playing new track seemlessly)
-    if (lastState == Playing)
-        playButton.triggerClick();
 }
 
 /**
 * @see MixdownFolder.h
 */
 void MixdownFolderComp::prevButtonClickResponse() {
-    TransportState lastState = state;
-    if (state != Stopped) {
+    //While playing, the previous project takes over without a gap; otherwise it's ready to play from the start
+    if (state != Playing && state != Stopped) {
         stateChange(Stopped);
     }
 
@@ -344,11 +537,6 @@ void MixdownFolderComp::prevButtonClickResponse() {
         nextButton.setEnabled(true);
         prevButton.setEnabled(true);
     }
-    
-    if (lastState == Playing) {
-        // Continue playing (begin playing new track seemlessly)
-        playButton.triggerClick();
-    }
 }
 
 /**
@@ -374,6 +562,108 @@ void MixdownFolderComp::stopButtonClickResponse() {
     }
 }
 
+/**
+* Renders a project's mix on a background thread behind a progress window, which can cancel it.
+*/
+class BounceProgressWindow : public juce::ThreadWithProgressWindow {
+public:
+    BounceProgressWindow(Project& p, const juce::File& file, juce::AudioFormatManager& manager)
+        : ThreadWithProgressWindow("Bouncing " + p.getName(), true, true),
+          project(p), outputFile(file), formatManager(manager) {}
+
+    void run() override {
+        try {
+            ProjectBouncer bouncer(formatManager);
+            auto stats = bouncer.bounce(project, outputFile, [this] (double progress) {
+                setProgress(progress);
+                return ! threadShouldExit();
+            });
+
+            if (! threadShouldExit())
+                message = "Bounced " + juce::String(stats.audioSeconds, 1) + " s to " + outputFile.getFileName()
+                          + " at " + juce::String(stats.getSpeed(), 1) + "x real time.";
+        } catch (const char* error) {
+            message = error;
+        }
+    }
+
+    juce::String message;
+
+private:
+    Project& project;
+    const juce::File outputFile;
+    juce::AudioFormatManager& formatManager;
+};
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::bounceButtonClickResponse() {
+    if (currentProject == nullptr) return;
+
+    auto defaultFile = currentProject->getMixdownFile().getSiblingFile(currentProject->getName() + " bounce.wav");
+    juce::FileChooser fileChooser("Bounce the mix to", defaultFile, "*.wav;*.flac");
+    //Awaits user file selection
+    if (! fileChooser.browseForFileToSave(true)) return;
+
+    BounceProgressWindow window(*currentProject, fileChooser.getResult(), audioFormatManager);
+    if (window.runThread() && window.message.isNotEmpty())
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::InfoIcon, "Bounce", window.message);
+}
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::cacheBudgetChanged() {
+    //Shrinking the budget evicts the least recently used files straight away
+    decodedCache->setMemoryBudget((size_t) cacheBudgetBox.getSelectedId() << 20);
+    updateCacheStats();
+}
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::resamplingChanged() {
+    resamplingOptions.quality = (ResamplingQuality) (resamplingBox.getSelectedId() - 1);
+    resamplingOptions.preResample = preResampleButton.getToggleState();
+    prefetcher.setResamplingOptions(resamplingOptions);
+
+    //Playback switches filters straight away, carrying on from where it was
+    const bool wasPlaying = transport.isPlaying();
+    const bool hasSource = mixRate > 0.0 || reader != nullptr;
+    transport.setSource(nullptr);
+    playbackResampler.setQuality(resamplingOptions.quality);
+    if (hasSource) transport.setSource(&playbackResampler);
+    if (wasPlaying) transport.start();
+
+    //The loaded mix carries on as it is, but its neighbours are loaded again the new way
+    prefetchNeighbours();
+}
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::loopChanged() {
+    //The transport loops in samples at the device's rate, which is what it plays at
+    const double rate = transport.getSampleRate();
+    juce::Range<juce::int64> samples;
+    if (loopButton.getToggleState() && !loopRegion.isEmpty() && rate > 0.0)
+        samples = { (juce::int64) (loopRegion.getStart() * rate), (juce::int64) (loopRegion.getEnd() * rate) };
+
+    transport.setLoopRange(samples);
+    transport.setLoopCrossfade(loopCrossfadeButton.getToggleState() ? loopCrossfadeSeconds : 0.0);
+    tn->setLoopRegion(loopButton.getToggleState() ? loopRegion : juce::Range<double>());
+}
+
+/**
+* @see MixdownFolder.h
+*/
+void MixdownFolderComp::clearLoop() {
+    loopRegion = {};
+    loopButton.setToggleState(false, juce::dontSendNotification);
+    loopChanged();
+}
+
 /*
   ==============================================================================
 
@@ -406,7 +696,19 @@ void MixdownFolderComp::resized() {
     zoomSlider.setBounds(zoom);    
     
     //Scaled to the parent window view
-    fileBoxMenu.setBounds(area.removeFromTop(41).reduced(8));
+    auto menuRow = area.removeFromTop(41);
+    bounceButton.setBounds(menuRow.removeFromRight(100).reduced(8));
+    resamplingBox.setBounds(menuRow.removeFromRight(170).reduced(8));
+    preResampleButton.setBounds(menuRow.removeFromRight(120).reduced(8));
+    fileBoxMenu.setBounds(menuRow.reduced(8));
+
+    auto loopRow = area.removeFromTop(41);
+    loopStartButton.setBounds(loopRow.removeFromLeft(130).reduced(8));
+    loopEndButton.setBounds(loopRow.removeFromLeft(130).reduced(8));
+    loopButton.setBounds(loopRow.removeFromLeft(80).reduced(8));
+    loopCrossfadeButton.setBounds(loopRow.removeFromLeft(110).reduced(8));
+    cacheBudgetBox.setBounds(loopRow.removeFromRight(140).reduced(8));
+    cacheStatsLabel.setBounds(loopRow.reduced(8));
     
     // transport buttons
     juce::Grid prevNextGrid;
@@ -423,6 +725,8 @@ void MixdownFolderComp::resized() {
     
     prevNextGrid.setGap(juce::Grid::Px(12));
     prevNextGrid.performLayout(area.removeFromTop(80).reduced(8));
+
+    mixerComp.setBounds(area.reduced(8));
 }
 
 
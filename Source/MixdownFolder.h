@@ -16,7 +16,13 @@
 #include "DemoUtilities.h"
 
 #include "ProjectManagement.h"
+#include "ProjectMixSource.h"
+#include "MixSwitcher.h"
+#include "DecodedAudioCache.h"
+#include "StreamingAudioSource.h"
+#include "LayerMixer.h"
 #include "AudioRecorder.h"
+#include "PlaybackTransport.h"
 
 class MixdownFolderComp :   public juce::Component,
                             public juce::AudioSource,
@@ -91,10 +97,16 @@ public:
     */
     void resized() override;
                                 
-    juce::AudioTransportSource* getTransportPtr() { return &(this->transport); }
+    PlaybackTransport* getTransportPtr() { return &(this->transport); }
                                 
     void triggerPlayback();
 
+    /**
+    * Function reloads the current project's layers into playback, e.g. after a new one is recorded.
+    * Playback carries on uninterrupted.
+    */
+    void reloadLayers();
+
  /*
    ==============================================================================
 
@@ -126,8 +138,48 @@ private:
     //Audio format manager, audio transport source, and audio format reader source for
     //formatting and preparing audio files for playback
     juce::AudioFormatManager audioFormatManager;
-    std::unique_ptr<juce::AudioFormatReaderSource> reader;
-    juce::AudioTransportSource transport;
+    std::unique_ptr<juce::PositionableAudioSource> reader;
+    MixSwitchSource mixSwitcher; //plays the selected project's mixdown and layers together
+    MixPrefetcher prefetcher{ audioFormatManager, thread }; //has the neighbouring projects ready to play
+    Project* currentProject = nullptr;
+    juce::SharedResourcePointer<DecodedAudioCache> decodedCache; //recently played audio, shared with every mix
+    double mixRate = 0.0; //sample rate the playback resampler converts mixes from, or 0 while it isn't playing them
+
+    //Converts whatever's playing to the device's sample rate, in place of the transport's own resampling
+    SincResamplingSource playbackResampler{ nullptr, false };
+    ResamplingOptions resamplingOptions;
+
+    //Length of the crossfade when the project changes during playback
+    static constexpr double switchCrossfadeSeconds = 0.05;
+
+    /**
+    * Function starts loading the projects either side of the selected one in the background.
+    */
+    void prefetchNeighbours();
+
+    /**
+    * Function switches playback over to a project once it has loaded in the background.
+    *
+    * @param selected  The project that was loaded.
+    * @param loadedMix  Its mix, or nullptr if it couldn't be loaded.
+    */
+    void projectLoaded(Project& selected, std::unique_ptr<ProjectMixSource> loadedMix);
+
+    /**
+    * Function tells the user about any layers a newly loaded mix had to leave out.
+    *
+    * @param mix  The mix that was loaded.
+    */
+    void warnAboutUnplayableLayers(const ProjectMixSource& mix);
+
+    /**
+    * Function gets the settings of the running audio device, to prepare mixes with.
+    *
+    * @param blockSize  Set to the device's buffer size; left alone if there's no device.
+    * @param sampleRate  Set to the device's sample rate; left alone if there's no device.
+    */
+    void getDeviceSettings(int& blockSize, double& sampleRate);
+    PlaybackTransport transport;
                                 
     LayerRecorderComponent& layerRecorder;
 
@@ -183,6 +235,37 @@ private:
     juce::TextButton stopButton;
     void stopButtonClickResponse();
 
+    //Render the selected project's mix to a new file and event response
+    juce::TextButton bounceButton;
+    void bounceButtonClickResponse();
+
+    //Resampling quality, and whether files are resampled ahead of time, and event response
+    juce::ComboBox resamplingBox;
+    juce::ToggleButton preResampleButton;
+    void resamplingChanged();
+
+    //Region played over and over, with its ends set from the playhead, and event response
+    juce::TextButton loopStartButton;
+    juce::TextButton loopEndButton;
+    juce::ToggleButton loopButton;
+    juce::ToggleButton loopCrossfadeButton;
+    juce::Range<double> loopRegion; //in seconds, so it carries over a change of device sample rate
+    void loopChanged();
+    void clearLoop();
+
+    //Length of the crossfade at the loop's seam, when there is one
+    static constexpr double loopCrossfadeSeconds = 0.01;
+
+    //How much of the decoded audio cache is in use and how often it's hit, as of the last project load
+    juce::Label cacheStatsLabel;
+    void updateCacheStats();
+
+    //How much memory the decoded audio cache may use, and event response
+    juce::ComboBox cacheBudgetBox;
+    void cacheBudgetChanged();
+
+    //Gain, pan, mute and solo for each of the selected project's layers
+    LayerMixerComponent mixerComp;
 
 
     void showAudioResource(URL resource)
@@ -199,12 +282,51 @@ private:
         transport.stop();
         transport.setSource(nullptr);
         reader.reset();
+        prefetcher.cancelLoad();
+        mixerComp.setProject(nullptr, nullptr);
+        bounceButton.setEnabled(false);
+        mixSwitcher.switchTo(nullptr, 0.0);
+        mixRate = 0.0;
+        currentProject = nullptr;
+        clearLoop();
 
         AudioFormatReader* reader2 = nullptr;
 
     #if ! JUCE_IOS
         if (audioURL.isLocalFile())
         {
+            //Uncompressed files play straight from memory-mapped storage, so seeking is instant
+            if (auto mapped = MappedAudioSource::create(audioURL.getLocalFile(), audioFormatManager, thread))
+            {
+                const double sampleRate = mapped->getReader().sampleRate;
+                reader = std::move(mapped);
+                playbackResampler.setInput(reader.get(), sampleRate);
+                transport.setSource(&playbackResampler);
+                return true;
+            }
+
+            //Others play from memory if they were decoded recently
+            if (auto decoded = decodedCache->find(audioURL.getLocalFile()))
+            {
+                const double sampleRate = decoded->sampleRate;
+                reader.reset(new CachedAudioSource(std::move(decoded)));
+                playbackResampler.setInput(reader.get(), sampleRate);
+                transport.setSource(&playbackResampler);
+                return true;
+            }
+
+            decodedCache->decodeInBackground(audioURL.getLocalFile());
+
+            //Compressed ones are decoded well ahead of playback, on a thread of their own
+            if (auto streaming = StreamingAudioSource::create(audioURL.getLocalFile(), audioFormatManager))
+            {
+                const double sampleRate = streaming->getReader().sampleRate;
+                reader = std::move(streaming);
+                playbackResampler.setInput(reader.get(), sampleRate);
+                transport.setSource(&playbackResampler);
+                return true;
+            }
+
             reader2 = audioFormatManager.createReaderFor(audioURL.getLocalFile());
         }
         else
@@ -216,12 +338,12 @@ private:
 
         if (reader2 != nullptr)
         {
-            reader.reset(new AudioFormatReaderSource(reader2, true));
+            //Read ahead on the preview thread, as the transport used to do itself
+            reader.reset(new BufferingAudioSource(new AudioFormatReaderSource(reader2, true), thread, true,
+                                                  32768, (int) reader2->numChannels));
 
-            transport.setSource(reader.get(),
-                32768,                   
-                &thread,              
-                reader2->sampleRate);     
+            playbackResampler.setInput(reader.get(), reader2->sampleRate);
+            transport.setSource(&playbackResampler);
 
             return true;
         }
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    PeakCache.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "PeakCache.h"
+
+
+//===================================== PeakCache =========================================
+
+PeakCache::PeakCache(const juce::File& dir) : AudioThumbnailCache(maxThumbsInMemory), directory(dir) {
+    directory.createDirectory();
+}
+
+PeakCache::~PeakCache() {}
+
+juce::int64 PeakCache::getHashFor(const juce::File& file) {
+    return (file.getFullPathName() + "|" + juce::String(file.getSize())
+            + "|" + juce::String(file.getLastModificationTime().toMilliseconds())).hashCode64();
+}
+
+juce::File PeakCache::getDefaultDirectory() {
+    // Peaks can always be rebuilt, so they go where each platform keeps caches rather than with roaming or
+    // backed-up settings
+   #if JUCE_MAC
+    auto base = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory).getChildFile("Caches");
+   #elif JUCE_WINDOWS
+    auto base = juce::File::getSpecialLocation(juce::File::windowsLocalAppData);
+   #elif JUCE_LINUX || JUCE_BSD
+    // The XDG base directory spec ignores a relative XDG_CACHE_HOME
+    const auto xdgCache = juce::SystemStats::getEnvironmentVariable("XDG_CACHE_HOME", {});
+    auto base = juce::File::isAbsolutePath(xdgCache) ? juce::File(xdgCache)
+                                                     : juce::File::getSpecialLocation(juce::File::userHomeDirectory).getChildFile(".cache");
+   #else
+    auto base = juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory);
+   #endif
+    return base.getChildFile("Spark").getChildFile("Peaks");
+}
+
+juce::File PeakCache::getPeakFile(juce::int64 hashCode) const {
+    return directory.getChildFile(juce::String::toHexString(hashCode) + ".peaks");
+}
+
+void PeakCache::saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) {
+    juce::MemoryOutputStream data;
+    thumb.saveTo(data);
+
+    // Written aside and moved into place, so a crash never leaves half a peak file to be loaded
+    const juce::TemporaryFile temp (getPeakFile(hashCode));
+    if (! temp.getFile().replaceWithData(data.getData(), data.getDataSize())
+        || ! temp.overwriteTargetFileWithTemporary())
+        return;
+
+    // Thumbnails are saved on the cache's thread, so that's where the folder is kept in check. It's only
+    // listed when the running total says it may be too big, or for the first save since launch.
+    if (diskUsage >= 0) diskUsage += (juce::int64) data.getDataSize();
+    if (diskUsage < 0 || diskUsage > maxDiskUsage) trimDiskUsage();
+}
+
+bool PeakCache::loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode) {
+    const auto file = getPeakFile(hashCode);
+
+    juce::MemoryBlock data;
+    if (! file.loadFileAsData(data) || data.isEmpty()) return false;
+
+    // Touched, so trimming deletes the peaks that have gone unused longest
+    file.setLastModificationTime(juce::Time::getCurrentTime());
+
+    juce::MemoryInputStream in (data, false);
+    return thumb.loadFrom(in);
+}
+
+void PeakCache::trimDiskUsage() {
+    auto files = directory.findChildFiles(juce::File::findFiles, false, "*.peaks");
+
+    juce::int64 total = 0;
+    for (auto& file : files)
+        total += file.getSize();
+
+    diskUsage = total;
+    if (total <= maxDiskUsage) return;
+
+    std::sort(files.begin(), files.end(), [] (const juce::File& a, const juce::File& b) {
+        return a.getLastModificationTime() < b.getLastModificationTime();
+    });
+
+    for (auto& file : files) {
+        if (total <= maxDiskUsage) break;
+        total -= file.getSize();
+        file.deleteFile();
+    }
+    diskUsage = total;
+}
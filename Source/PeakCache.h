@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    PeakCache.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Waveform peaks kept on disk between launches.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+/**
+ An AudioThumbnailCache that also keeps every thumbnail it finishes in a peak file on disk, so a file's
+ waveform is only ever scanned once. Peak files are keyed by the audio file's path, size and modification
+ time (see getHashFor()), so changing a file on disk makes its peaks stale, and each is loaded with a single
+ read. The oldest are deleted once they take up more than maxDiskUsage, which is checked on the cache's
+ thread as peaks are saved.
+
+ One cache is shared by every thumbnail in the app, through a juce::SharedResourcePointer. Thumbnails must be
+ given sources whose hash codes come from getHashFor(), such as a PeakCache::FileSource, for their peaks to
+ be found again on the next launch.
+ */
+class PeakCache : public juce::AudioThumbnailCache {
+public:
+    /** @param directory   Where the peak files are kept. */
+    explicit PeakCache(const juce::File& directory = getDefaultDirectory());
+    ~PeakCache() override;
+
+    /** The hash code a file's thumbnail is cached under. Changes whenever the file does. */
+    static juce::int64 getHashFor(const juce::File& file);
+
+    /** A folder for peak files in the user's local cache (Caches on the Mac, LocalAppData on Windows, $XDG_CACHE_HOME
+        or ~/.cache on Linux), which is where they go by default. */
+    static juce::File getDefaultDirectory();
+
+    /** An InputSource for a local file that hashes as getHashFor() does. */
+    class FileSource : public juce::InputSource {
+    public:
+        explicit FileSource(const juce::File& f) : file(f) {}
+
+        juce::InputStream* createInputStream() override { return file.createInputStream().release(); }
+        juce::InputStream* createInputStreamFor(const juce::String& relativeItemPath) override {
+            return file.getSiblingFile(relativeItemPath).createInputStream().release();
+        }
+        juce::int64 hashCode() const override { return getHashFor(file); }
+
+    private:
+        const juce::File file;
+    };
+
+    static constexpr int maxThumbsInMemory = 50;
+    static constexpr juce::int64 maxDiskUsage = (juce::int64) 1024 * 1024 * 1024;
+
+protected:
+    void saveNewlyFinishedThumbnail(const juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+    bool loadNewThumb(juce::AudioThumbnailBase& thumb, juce::int64 hashCode) override;
+
+private:
+    juce::File getPeakFile(juce::int64 hashCode) const;
+    void trimDiskUsage();
+
+    const juce::File directory;
+    juce::int64 diskUsage = -1; // roughly, as of the last trim plus what's been saved since; -1 until the first
+
+    JUCE_DECLARE_NON_COPYABLE (PeakCache)
+};
@@ -0,0 +1,302 @@
+/*
+  ==============================================================================
+
+    PlaybackTransport.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "PlaybackTransport.h"
+
+
+//===================================== PlaybackTransport =========================================
+
+PlaybackTransport::PlaybackTransport() {
+    startTimerHz(30);
+}
+
+PlaybackTransport::~PlaybackTransport() {
+    setSource(nullptr);
+}
+
+void PlaybackTransport::setSource(juce::PositionableAudioSource* newSource) {
+    if (newSource == source) return;
+
+    activeSource = nullptr;
+    callbackEpoch.waitForCallbackToFinish();
+
+    if (source != nullptr) source->releaseResources();
+    source = newSource;
+    if (source != nullptr && blockSize > 0) source->prepareToPlay(blockSize, sampleRate.load());
+
+    // Whatever was kept of the loop came from the old source
+    invalidateLoopBuffer();
+    activeSource = source;
+}
+
+void PlaybackTransport::start() {
+    request([] (Requests& r) { r.play = 1; });
+}
+
+void PlaybackTransport::stop() {
+    request([] (Requests& r) { r.play = 0; });
+}
+
+void PlaybackTransport::setPosition(double newPosition) {
+    const auto rate = sampleRate.load();
+    if (rate > 0.0) setNextReadPosition((juce::int64) (newPosition * rate));
+}
+
+void PlaybackTransport::setNextReadPosition(juce::int64 newPosition) {
+    // Paged in here, so the audio thread only ever seeks to memory that's already loaded
+    PrefetchableSource::prefetch(source, newPosition);
+    request([newPosition] (Requests& r) { r.seek = newPosition; });
+
+    // Shown straight away, so the playhead follows the mouse even while the audio thread is a block behind
+    position = newPosition;
+}
+
+void PlaybackTransport::setLoopRange(juce::Range<juce::int64> samples) {
+    const auto minLength = (juce::int64) (minLoopSeconds * sampleRate.load());
+    if (! samples.isEmpty() && samples.getLength() < minLength)
+        samples.setLength(minLength);
+
+    loopRange = samples;
+
+    // Each pass starts from the loop's start, or once that's kept in memory, from where the kept part ends
+    if (! samples.isEmpty()) {
+        PrefetchableSource::prefetch(source, samples.getStart());
+        PrefetchableSource::prefetch(source, samples.getStart() + juce::jmin(samples.getLength(),
+                                                                             (juce::int64) (loopBufferSeconds * sampleRate.load())));
+    }
+
+    request([samples] (Requests& r) {
+        r.loopChanged = true;
+        r.loop = samples;
+    });
+}
+
+void PlaybackTransport::setLoopCrossfade(double seconds) {
+    crossfadeSeconds = juce::jlimit(0.0, maxCrossfadeSeconds, seconds);
+    const auto length = (juce::int64) (crossfadeSeconds.load() * sampleRate.load());
+    request([length] (Requests& r) { r.crossfade = length; });
+}
+
+void PlaybackTransport::invalidateLoopBuffer() {
+    request([] (Requests& r) { r.invalidate = true; });
+}
+
+double PlaybackTransport::getCurrentPosition() const noexcept {
+    const auto rate = sampleRate.load();
+    return rate > 0.0 ? (double) position.load() / rate : 0.0;
+}
+
+double PlaybackTransport::getLengthInSeconds() const {
+    const auto rate = sampleRate.load();
+    return rate > 0.0 ? (double) getTotalLength() / rate : 0.0;
+}
+
+juce::int64 PlaybackTransport::getTotalLength() const {
+    return source != nullptr ? source->getTotalLength() : 0;
+}
+
+void PlaybackTransport::processRequests(juce::PositionableAudioSource* src) noexcept {
+    Requests r;
+    {
+        // If the message thread is making a request right now, it's picked up next block along with the rest
+        const juce::SpinLock::ScopedTryLockType tl (requestLock);
+        if (! tl.isLocked()) return;
+        r = requests;
+        requests = {};
+    }
+
+    // The loop is dealt with before a seek, since dropping the loop's kept start moves the source back to the
+    // playhead, which the seek then moves on from
+    if (r.loopChanged) {
+        stopPlayingLoopStart(src);
+        activeLoop = r.loop;
+        loopBufferLength = (int) juce::jmin((juce::int64) loopBuffer.getNumSamples(), activeLoop.getLength());
+        loopBufferFilled = 0;
+    }
+
+    if (r.crossfade >= 0)
+        crossfadeLength = (int) juce::jmin(r.crossfade, (juce::int64) tailBuffer.getNumSamples());
+
+    if (r.invalidate) {
+        stopPlayingLoopStart(src);
+        loopBufferFilled = 0;
+    }
+
+    if (r.seek >= 0) {
+        loopBufferPosition = -1;
+        tailLength = 0;
+        playhead = r.seek;
+        if (src != nullptr) src->setNextReadPosition(r.seek);
+    }
+
+    if (r.play >= 0) shouldPlay = r.play == 1;
+}
+
+void PlaybackTransport::timerCallback() {
+    const bool isPlayingNow = playing.load();
+    if (isPlayingNow != notifiedPlaying) {
+        notifiedPlaying = isPlayingNow;
+        sendChangeMessage();
+    }
+}
+
+//==============================================================================
+void PlaybackTransport::captureLoopStart(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept {
+    const auto loopStart = activeLoop.getStart();
+    const auto from = juce::jmax(playhead, loopStart);
+    const auto to = juce::jmin(playhead + numSamples, loopStart + loopBufferLength);
+
+    // Only ever filled in one piece from the loop's start, so there are no gaps in it
+    if (to <= from || from - loopStart != loopBufferFilled) return;
+
+    const int num = (int) (to - from);
+    if (loopBufferFilled == 0) loopBufferChannels = juce::jmin(buffer.getNumChannels(), loopBuffer.getNumChannels());
+
+    for (int ch = 0; ch < loopBufferChannels; ++ch)
+        loopBuffer.copyFrom(ch, loopBufferFilled, buffer, ch, startSample + (int) (from - playhead), num);
+    loopBufferFilled += num;
+}
+
+int PlaybackTransport::playLoopStart(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept {
+    const int num = juce::jmin(numSamples, loopBufferLength - loopBufferPosition);
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        if (ch < loopBufferChannels) buffer.copyFrom(ch, startSample, loopBuffer, ch, loopBufferPosition, num);
+        else buffer.clear(ch, startSample, num);
+    }
+
+    // The loop's start fades in over what would have followed its end
+    if (loopBufferPosition < tailLength) {
+        const int fade = juce::jmin(num, tailLength - loopBufferPosition);
+        const float from = (float) loopBufferPosition / (float) tailLength;
+        const float to = (float) (loopBufferPosition + fade) / (float) tailLength;
+
+        buffer.applyGainRamp(startSample, fade, from, to);
+        for (int ch = 0; ch < juce::jmin(buffer.getNumChannels(), tailChannels); ++ch)
+            buffer.addFromWithRamp(ch, startSample, tailBuffer.getReadPointer(ch, loopBufferPosition), fade, 1.0f - from, 1.0f - to);
+    }
+
+    loopBufferPosition += num;
+    if (loopBufferPosition == loopBufferLength) loopBufferPosition = -1; // the source carries on from here
+    return num;
+}
+
+void PlaybackTransport::wrapLoop(juce::PositionableAudioSource& src, int numChannels) noexcept {
+    playhead = activeLoop.getStart();
+
+    if (loopBufferLength == 0 || loopBufferFilled < loopBufferLength) {
+        // Not kept yet, so it's played from the source this time and captured on the way
+        loopBufferFilled = 0;
+        tailLength = 0;
+        src.setNextReadPosition(playhead);
+        return;
+    }
+
+    // The source is still just past the loop's end, which is what the crossfade fades out
+    tailLength = juce::jmin(crossfadeLength, loopBufferLength);
+    if (tailLength > 0) {
+        tailChannels = juce::jmin(numChannels, tailBuffer.getNumChannels());
+        juce::AudioBuffer<float> tail (tailBuffer.getArrayOfWritePointers(), tailChannels, tailLength);
+        src.getNextAudioBlock(juce::AudioSourceChannelInfo(tail));
+    }
+
+    src.setNextReadPosition(playhead + loopBufferLength);
+    loopBufferPosition = 0;
+}
+
+void PlaybackTransport::stopPlayingLoopStart(juce::PositionableAudioSource* src) noexcept {
+    if (loopBufferPosition < 0) return;
+
+    loopBufferPosition = -1;
+    tailLength = 0;
+    if (src != nullptr) src->setNextReadPosition(playhead);
+}
+
+//==============================================================================
+void PlaybackTransport::prepareToPlay(int samplesPerBlockExpected, double newSampleRate) {
+    blockSize = samplesPerBlockExpected;
+    sampleRate = newSampleRate;
+
+    loopBuffer.setSize(maxChannels, (int) (loopBufferSeconds * newSampleRate));
+    tailBuffer.setSize(maxChannels, (int) (maxCrossfadeSeconds * newSampleRate));
+    loopBufferLength = (int) juce::jmin((juce::int64) loopBuffer.getNumSamples(), activeLoop.getLength());
+    loopBufferFilled = 0;
+    loopBufferPosition = -1;
+    tailLength = 0;
+    crossfadeLength = (int) (crossfadeSeconds.load() * newSampleRate);
+
+    if (source != nullptr) source->prepareToPlay(samplesPerBlockExpected, newSampleRate);
+}
+
+void PlaybackTransport::releaseResources() {
+    if (source != nullptr) source->releaseResources();
+    blockSize = 0;
+}
+
+void PlaybackTransport::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    const CallbackEpoch::ScopedCallback inCallback (callbackEpoch);
+    auto* src = activeSource.load();
+    processRequests(src);
+
+    // Unless the loop's start is playing from memory, the playhead is wherever the source is
+    if (src != nullptr && loopBufferPosition < 0) playhead = src->getNextReadPosition();
+    lastBlock = { shouldPlay && src != nullptr, playhead, -1 };
+
+    const float targetGain = shouldPlay ? 1.0f : 0.0f;
+    if (src == nullptr || (lastGain == 0.0f && targetGain == 0.0f)) {
+        bufferToFill.clearActiveBufferRegion();
+        lastGain = 0.0f;
+        playing = shouldPlay;
+        position = playhead;
+        return;
+    }
+
+    auto& buffer = *bufferToFill.buffer;
+
+    // Played in pieces split at the end of the loop, so it wraps on exactly the right sample
+    for (int done = 0; done < bufferToFill.numSamples;) {
+        const int startSample = bufferToFill.startSample + done;
+        const bool inLoop = ! activeLoop.isEmpty() && playhead < activeLoop.getEnd();
+        int num = bufferToFill.numSamples - done;
+
+        if (loopBufferPosition >= 0) {
+            num = playLoopStart(buffer, startSample, num);
+        } else {
+            if (inLoop) num = (int) juce::jmin((juce::int64) num, activeLoop.getEnd() - playhead);
+            src->getNextAudioBlock({ &buffer, startSample, num });
+            if (! activeLoop.isEmpty()) captureLoopStart(buffer, startSample, num);
+        }
+
+        done += num;
+        playhead += num;
+
+        if (inLoop && playhead == activeLoop.getEnd()) {
+            if (lastBlock.wrapOffset < 0) {
+                lastBlock.wrapOffset = done;
+                lastBlock.wrapTo = activeLoop.getStart();
+            }
+            wrapLoop(*src, buffer.getNumChannels());
+        }
+    }
+
+    if (lastGain != targetGain)
+        buffer.applyGainRamp(bufferToFill.startSample, bufferToFill.numSamples, lastGain, targetGain);
+    lastGain = targetGain;
+
+    // Stop at the end, as an AudioTransportSource does
+    const auto length = src->getTotalLength();
+    if (shouldPlay && activeLoop.isEmpty() && length > 0 && playhead >= length) {
+        shouldPlay = false;
+        lastGain = 0.0f;
+    }
+
+    playing = shouldPlay;
+    position = playhead;
+}
@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    PlaybackTransport.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Play, pause, seek and loop for a PositionableAudioSource, driven from the
+    message thread without ever blocking the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeSync.h"
+
+
+/**
+ Stands in for a juce::AudioTransportSource, except that nothing the message thread does takes a lock the
+ audio thread waits on. start(), stop(), setPosition() and setLoopRange() only leave a request, which the
+ audio thread carries out at the start of its next block, so scrubbing can seek as often as it likes without
+ contending with playback. Only the latest request of each kind counts, so however many pile up while the
+ device is stopped, the last seek, play or loop is the one carried out once it starts again. What the audio
+ thread has actually done (whether it's playing, and where) is published back through atomics, and a change
+ message is sent whenever playback starts or stops, as with an AudioTransportSource.
+
+ The source is played at the rate it's prepared at; put a resampler in front of it if that's not its own.
+ Starting and stopping are ramped over a block to avoid clicks.
+ */
+class PlaybackTransport : public juce::PositionableAudioSource,
+                          public juce::ChangeBroadcaster,
+                          private juce::Timer {
+public:
+    PlaybackTransport();
+    ~PlaybackTransport() override;
+
+    /**
+     Change what's played, preparing the new source and releasing the old one. Whether it's playing doesn't
+     change. Waits for the audio thread to finish with the old source, so it can be deleted afterwards.
+     @param newSource   The source to play, which this doesn't own, or nullptr.
+     */
+    void setSource(juce::PositionableAudioSource* newSource);
+
+    juce::PositionableAudioSource* getSource() const noexcept { return source; }
+
+    /** Start playing from the current position, from the next block. */
+    void start();
+
+    /** Stop playing, leaving the position where it stops. */
+    void stop();
+
+    /** Move the playhead, in seconds at the rate this is prepared at. The source is prefetched there first. */
+    void setPosition(double newPosition);
+
+    /**
+     Play a region over and over, jumping back to its start on the sample it ends. Playback carries on
+     normally from where it is until it reaches the region.
+
+     The first time through, the start of the region is kept in memory as it plays. From then on each pass
+     begins by playing that, while the source jumps ahead to where it ends, so the jump never waits on the
+     disk and whatever reads ahead has that long to catch up.
+     The source is prefetched at both of the places a pass starts reading from, before the loop is set.
+     @param samples     The region, or an empty range to stop looping. Regions shorter than minLoopSeconds
+                        are lengthened to it.
+     */
+    void setLoopRange(juce::Range<juce::int64> samples);
+
+    /** The region being looped, as last set; empty if none. */
+    juce::Range<juce::int64> getLoopRange() const noexcept { return loopRange; }
+
+    /**
+     Crossfade from what follows the end of the loop into its start, rather than cutting straight over.
+     @param seconds     How long the crossfade lasts, up to maxCrossfadeSeconds; 0 to cut.
+     */
+    void setLoopCrossfade(double seconds);
+
+    /**
+     Have the loop's start kept in memory afresh, because the source's audio has changed (its mix, say). The
+     next pass plays it from the source again.
+     */
+    void invalidateLoopBuffer();
+
+    /** Whether the audio thread is playing. Requests made since its last block aren't reflected yet. */
+    bool isPlaying() const noexcept { return playing.load(); }
+
+    /** The playhead, in seconds, as of the audio thread's last block. */
+    double getCurrentPosition() const noexcept;
+
+    double getLengthInSeconds() const;
+
+    /** The rate this is prepared at, or 0 if it isn't. */
+    double getSampleRate() const noexcept { return sampleRate.load(); }
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    /** Prefetches the source and queues a seek, as setPosition() does. */
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override { return position.load(); }
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override { return ! loopRange.isEmpty(); }
+
+    /** What the last block played, for whatever renders this on the audio thread. */
+    struct BlockInfo {
+        bool playing = false;   // whether it played the source, rather than silence
+        juce::int64 start = 0;  // the position its first sample came from
+        int wrapOffset = -1;    // the sample on which the loop jumped back to its start, or -1
+        juce::int64 wrapTo = 0; // the start it jumped back to
+    };
+
+    /** Only for the audio thread, straight after getNextAudioBlock(). Loops are longer than any block, so a
+        block only ever wraps once. */
+    const BlockInfo& getLastBlockInfo() const noexcept { return lastBlock; }
+
+    static constexpr double minLoopSeconds = 0.5;
+    static constexpr double loopBufferSeconds = 0.5;   // how much of a loop's start is kept in memory
+    static constexpr double maxCrossfadeSeconds = 0.1;
+
+private:
+    /**
+     What the message thread has asked for since the audio thread last looked. A newer request of the same kind
+     replaces an older one; they don't depend on the order they came in.
+     */
+    struct Requests {
+        int play = -1;                  // 1 to play, 0 to pause, -1 to leave it
+        juce::int64 seek = -1;          // the position to seek to, or -1
+        bool loopChanged = false;
+        juce::Range<juce::int64> loop;  // the new loop range, if it changed
+        juce::int64 crossfade = -1;     // the new crossfade length, in samples, or -1
+        bool invalidate = false;        // whether the kept loop start is to be dropped
+    };
+
+    /** Changes the pending requests. The lock is only ever held for a moment, and the audio thread never waits on it. */
+    template <typename Change>
+    void request(Change&& change) {
+        const juce::SpinLock::ScopedLockType sl (requestLock);
+        change(requests);
+    }
+
+    void processRequests(juce::PositionableAudioSource* source) noexcept;
+    void timerCallback() override;
+
+    // Audio thread only
+    void captureLoopStart(const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+    int playLoopStart(juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept;
+    void wrapLoop(juce::PositionableAudioSource& source, int numChannels) noexcept;
+    void stopPlayingLoopStart(juce::PositionableAudioSource* source) noexcept;
+
+    juce::PositionableAudioSource* source = nullptr;
+    std::atomic<juce::PositionableAudioSource*> activeSource { nullptr };
+    CallbackEpoch callbackEpoch;
+
+    juce::SpinLock requestLock; // the audio thread only tries it, and leaves the requests for its next block if it's held
+    Requests requests;
+
+    int blockSize = 0;
+    std::atomic<double> sampleRate { 0.0 };
+    juce::Range<juce::int64> loopRange; // as last set by the message thread
+    std::atomic<double> crossfadeSeconds { 0.0 };
+
+    // Published by the audio thread
+    std::atomic<bool> playing { false };
+    std::atomic<juce::int64> position { 0 };
+
+    // Only touched by the audio thread
+    bool shouldPlay = false;
+    float lastGain = 0.0f;
+    juce::int64 playhead = 0;
+    BlockInfo lastBlock;
+    juce::Range<juce::int64> activeLoop;
+    int crossfadeLength = 0;
+
+    // The start of the loop, kept in memory. While it's playing, the source waits at the end of it.
+    juce::AudioBuffer<float> loopBuffer;
+    int loopBufferLength = 0;   // how much of the loop it holds once full
+    int loopBufferFilled = 0;   // how much has been captured, from the loop's start
+    int loopBufferChannels = 0;
+    int loopBufferPosition = -1; // where it's being played from, or -1
+
+    // What followed the end of the loop, faded out over the start of the next pass
+    juce::AudioBuffer<float> tailBuffer;
+    int tailLength = 0, tailChannels = 0;
+
+    static constexpr int maxChannels = 8;
+
+    bool notifiedPlaying = false; // what listeners were last told, on the message thread
+
+    JUCE_DECLARE_NON_COPYABLE (PlaybackTransport)
+};
@@ -0,0 +1,192 @@
+/*
+  ==============================================================================
+
+    ProjectBounce.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "ProjectBounce.h"
+#include "ProjectMixSource.h"
+#include "SincResampler.h"
+
+
+//===================================== ChunkJob =========================================
+
+/** Mixes one stretch of the timeline into a buffer of its own. */
+class ProjectBouncer::ChunkJob : public juce::ThreadPoolJob {
+public:
+    ChunkJob(juce::AudioFormatManager& manager, const juce::Array<Source>& sourceList, double mixRate,
+             juce::int64 chunkStart, int chunkLength)
+        : ThreadPoolJob("bounce chunk"), start(chunkStart), length(chunkLength), formatManager(manager),
+          sources(sourceList), rate(mixRate) {}
+
+    JobStatus runJob() override {
+        mix.setSize(outputChannels, length);
+        mix.clear();
+        const auto end = start + length;
+
+        for (auto& source : sources) {
+            if (shouldExit()) break;
+
+            const auto from = juce::jmax(start, source.start);
+            const auto to = juce::jmin(end, source.start + source.length);
+            if (to <= from) continue;
+
+            // Readers aren't thread-safe, so every job opens its own
+            std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(source.file));
+            if (reader == nullptr) {
+                failed = true;
+                break;
+            }
+
+            const int num = (int) (to - from);
+            scratch.setSize(source.numChannels, num, false, false, true);
+
+            if (source.sampleRate == rate)
+                reader->read(&scratch, 0, num, from - source.start, true, true);
+            else
+                readResampled(*reader, source, from - source.start, num);
+
+            const float* noRamps[2] = { nullptr, nullptr };
+            ProjectMixSource::addPanned(mix, (int) (from - start), scratch, source.numChannels, source.gains, noRamps, num);
+        }
+
+        return jobHasFinished;
+    }
+
+    juce::AudioBuffer<float> mix;
+    const juce::int64 start;
+    const int length;
+    bool failed = false;
+
+private:
+    /** Reads part of a file at another rate than the mix into scratch, resampled to the mix's rate. */
+    void readResampled(juce::AudioFormatReader& reader, const Source& source, juce::int64 offset, int num) {
+        const double ratio = source.sampleRate / rate;
+        SincResampler resampler (source.numChannels);
+        resampler.prepare(ResamplingQuality::best, ratio, num);
+
+        // Reading starts far enough back for the filter to reach the first output; before the file is silence
+        const double firstInput = offset * ratio;
+        const auto inputStart = juce::jmax((juce::int64) 0, (juce::int64) std::floor(firstInput) - resampler.getLookBehind());
+        resampler.reset(firstInput - inputStart);
+
+        // As is anything past its end
+        const int needed = resampler.getNumInputSamplesNeeded(num);
+        input.setSize(source.numChannels, needed, false, false, true);
+        reader.read(&input, 0, needed, inputStart, true, true);
+        resampler.process(input.getArrayOfReadPointers(), needed, scratch.getArrayOfWritePointers(), num);
+    }
+
+    juce::AudioFormatManager& formatManager;
+    const juce::Array<Source>& sources;
+    const double rate;
+    juce::AudioBuffer<float> scratch, input;
+
+    JUCE_DECLARE_NON_COPYABLE (ChunkJob)
+};
+
+
+//===================================== ProjectBouncer =========================================
+
+ProjectBouncer::ProjectBouncer(juce::AudioFormatManager& manager, int threads)
+    : formatManager(manager), numThreads(juce::jmax(1, threads)) {}
+
+ProjectBouncer::Stats ProjectBouncer::bounce(Project& project, const juce::File& outputFile, ProgressCallback onProgress) {
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+    std::unique_ptr<juce::AudioFormatReader> mixdown (formatManager.createReaderFor(project.getMixdownFile()));
+    if (mixdown == nullptr) throw "Unable to read the project's mixdown";
+
+    // The mix runs at the mixdown's sample rate, just like playback, and any layer at another rate is
+    // resampled to it
+    const double rate = mixdown->sampleRate;
+    if (rate <= 0.0) throw "Unable to read the project's mixdown";
+    juce::int64 totalLength = mixdown->lengthInSamples;
+
+    juce::Array<Source> sources;
+    sources.add({ project.getMixdownFile(), 0, mixdown->lengthInSamples, (int) mixdown->numChannels, rate });
+
+    auto& mixer = project.getMixer();
+    const bool anySoloed = mixer.isAnySoloed();
+
+    for (auto& layer : project.layers) {
+        std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(layer.getFile()));
+        if (reader == nullptr || reader->lengthInSamples <= 0) continue;
+
+        // Left out, as in playback, rather than mixed at the wrong speed
+        if (! ProjectMixSource::canResample(reader->sampleRate, rate)) continue;
+
+        const auto length = (juce::int64) std::ceil(reader->lengthInSamples * rate / reader->sampleRate);
+        Source source { layer.getFile(), (juce::int64) std::llround(layer.getStartTime() * rate),
+                        length, (int) reader->numChannels, reader->sampleRate };
+        mixer.getSettings(layer.getFile()).getChannelGains(anySoloed, source.gains[0], source.gains[1]);
+        if (source.gains[0] == 0.0f && source.gains[1] == 0.0f) continue;
+
+        sources.add(source);
+        totalLength = juce::jmax(totalLength, source.start + source.length);
+    }
+
+    auto* format = formatManager.findFormatForFileExtension(outputFile.getFileExtension());
+    if (format == nullptr) throw "Unsupported file type for a bounce";
+    const int bitDepth = format->getPossibleBitDepths().contains(24) ? 24 : 16;
+
+    // Written beside the target, which is only replaced once everything is in
+    juce::TemporaryFile tempFile (outputFile);
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+
+    if (auto out = tempFile.getFile().createOutputStream()) {
+        writer.reset(format->createWriterFor(out.get(), rate, outputChannels, bitDepth, {}, 0));
+        if (writer != nullptr) out.release();
+    }
+    if (writer == nullptr) throw "Unable to write the bounce file";
+
+    const int chunkLength = (int) (chunkSeconds * rate);
+    const int numChunks = (int) ((totalLength + chunkLength - 1) / chunkLength);
+    const int maxQueued = numThreads * 2;
+
+    // Declared after the jobs, so the pool is done with them before they're deleted
+    juce::OwnedArray<ChunkJob> jobs;
+    juce::ThreadPool pool (numThreads);
+    int numQueued = 0;
+
+    for (int i = 0; i < numChunks; ++i) {
+        // Keep every thread busy without holding the whole mix in memory
+        for (; numQueued < juce::jmin(numChunks, i + maxQueued); ++numQueued) {
+            const auto chunkStart = (juce::int64) numQueued * chunkLength;
+            auto* job = jobs.add(new ChunkJob(formatManager, sources, rate, chunkStart,
+                                              (int) juce::jmin((juce::int64) chunkLength, totalLength - chunkStart)));
+            pool.addJob(job, false);
+        }
+
+        auto* job = jobs.getUnchecked(i);
+        pool.waitForJobToFinish(job, -1);
+
+        if (job->failed) {
+            pool.removeAllJobs(true, -1);
+            throw "Unable to read one of the project's layers";
+        }
+        if (! writer->writeFromAudioSampleBuffer(job->mix, 0, job->length)) {
+            pool.removeAllJobs(true, -1);
+            throw "Unable to write the bounce file";
+        }
+        jobs.set(i, nullptr);
+
+        if (onProgress != nullptr && ! onProgress((double) (i + 1) / numChunks)) {
+            pool.removeAllJobs(true, -1);
+            return {};
+        }
+    }
+
+    writer.reset(); // finishes off the file's header
+    if (! tempFile.overwriteTargetFileWithTemporary()) throw "Unable to write the bounce file";
+
+    Stats stats;
+    stats.numSamples = totalLength;
+    stats.audioSeconds = (double) totalLength / rate;
+    stats.renderSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    return stats;
+}
@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    ProjectBounce.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Offline rendering of a project's mix to a new file.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectManagement.h"
+
+
+/**
+ Renders a project's mixdown and layers, at the levels set in its ProjectMixer, into a single WAV or FLAC file
+ as fast as the machine allows.
+
+ The timeline is cut into chunks which are mixed in parallel on a ThreadPool, each job reading its own slice of
+ every file it overlaps, resampled to the mixdown's rate if the file is at another. The calling thread writes
+ the finished chunks out in order, and only a few chunks beyond the one being written are queued at a time, so
+ memory use doesn't grow with the length of the project.
+ */
+class ProjectBouncer {
+public:
+    /** What a finished bounce did. */
+    struct Stats {
+        juce::int64 numSamples = 0;
+        double audioSeconds = 0.0;
+        double renderSeconds = 0.0;
+
+        /** How many times faster than real time the render ran. */
+        double getSpeed() const noexcept { return renderSeconds > 0.0 ? audioSeconds / renderSeconds : 0.0; }
+    };
+
+    /**
+     Called on the bouncing thread after each chunk is written.
+     @param progress    How much of the project has been written, from 0 to 1.
+     @return    False to cancel the bounce.
+     */
+    using ProgressCallback = std::function<bool (double progress)>;
+
+    /**
+     @param formatManager   Used to open the mixdown and layers, and to find a format for the output file.
+     @param numThreads      How many threads mix chunks at once.
+     */
+    ProjectBouncer(juce::AudioFormatManager& formatManager, int numThreads = juce::SystemStats::getNumCpus());
+
+    /**
+     Render a project into a new file, replacing it if it already exists. The file's format is chosen by its
+     extension, and it is only replaced once the whole render has succeeded.
+     @throws    Error message if the mixdown can't be read or the file can't be written.
+     @param project     The project to mix, with its current mix settings.
+     @param outputFile  Where to write the mix, a .wav or .flac file.
+     @param onProgress  Optional; lets the caller follow and cancel the bounce.
+     @return    Timings of the bounce, or empty stats if it was cancelled.
+     */
+    Stats bounce(Project& project, const juce::File& outputFile, ProgressCallback onProgress = nullptr);
+
+private:
+    /** One file on the timeline and the level it's mixed at. */
+    struct Source {
+        juce::File file;
+        juce::int64 start = 0;  // in samples of the mix
+        juce::int64 length = 0; // in samples of the mix, once resampled to its rate
+        int numChannels = 0;
+        double sampleRate = 0.0; // the file's own
+        float gains[2] = { 1.0f, 1.0f };
+    };
+
+    class ChunkJob;
+
+    juce::AudioFormatManager& formatManager;
+    const int numThreads;
+
+    static constexpr double chunkSeconds = 10.0;
+    static constexpr int outputChannels = 2;
+
+    JUCE_DECLARE_NON_COPYABLE (ProjectBouncer)
+};
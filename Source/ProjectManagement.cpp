@@ -23,6 +23,99 @@ bool Layer::operator==(const Layer &other) {
 
 juce::File& Layer::getFile() { return layerFile; }
 
+juce::int64 Layer::getStartSample() {
+    readHeader();
+    return startSample;
+}
+
+double Layer::getStartTime() {
+    readHeader();
+    return sampleRate > 0.0 ? (double) startSample / sampleRate : 0.0;
+}
+
+juce::StringPairArray Layer::createMetadata(juce::int64 startSample) {
+    return juce::WavAudioFormat::createBWAVMetadata("Spark layer", "Spark", {}, juce::Time::getCurrentTime(), startSample, {});
+}
+
+void Layer::readHeader() {
+    if (headerRead) return;
+    
+    auto stream = layerFile.createInputStream();
+    if (stream == nullptr) return;
+    
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatReader> reader (wavFormat.createReaderFor(stream.release(), true));
+    
+    // A layer that is still being recorded may not have a readable header yet; try again next time
+    if (reader == nullptr) return;
+    
+    startSample = reader->metadataValues[juce::WavAudioFormat::bwavTimeReference].getLargeIntValue();
+    sampleRate = reader->sampleRate;
+    headerRead = true;
+}
+
+
+//===================================== ProjectMixer =========================================
+
+void LayerMixSettings::getChannelGains(bool anySoloed, float& left, float& right) const {
+    if (mute || (anySoloed && ! solo)) {
+        left = right = 0.0f;
+        return;
+    }
+    
+    const float angle = (juce::jlimit(-1.0f, 1.0f, pan) + 1.0f) * juce::MathConstants<float>::pi * 0.25f;
+    left = gain * juce::MathConstants<float>::sqrt2 * std::cos(angle);
+    right = gain * juce::MathConstants<float>::sqrt2 * std::sin(angle);
+}
+
+ProjectMixer::ProjectMixer(const juce::File& settingsFile) : file(settingsFile) {
+    auto xml = juce::parseXML(file);
+    if (xml == nullptr || ! xml->hasTagName("MIXER")) return;
+    
+    for (auto* layer : xml->getChildWithTagNameIterator("LAYER")) {
+        LayerMixSettings s;
+        s.gain = (float) layer->getDoubleAttribute("gain", 1.0);
+        s.pan = (float) layer->getDoubleAttribute("pan", 0.0);
+        s.mute = layer->getBoolAttribute("mute");
+        s.solo = layer->getBoolAttribute("solo");
+        settings.set(layer->getStringAttribute("file"), s);
+    }
+}
+
+LayerMixSettings ProjectMixer::getSettings(const juce::File& layerFile) const {
+    return settings.contains(layerFile.getFileName()) ? settings[layerFile.getFileName()] : LayerMixSettings();
+}
+
+void ProjectMixer::setSettings(const juce::File& layerFile, const LayerMixSettings& newSettings) {
+    settings.set(layerFile.getFileName(), newSettings);
+    needsSaving = true;
+    ++revision;
+}
+
+bool ProjectMixer::isAnySoloed() const {
+    for (juce::HashMap<juce::String, LayerMixSettings>::Iterator i (settings); i.next();)
+        if (i.getValue().solo) return true;
+    return false;
+}
+
+void ProjectMixer::save() {
+    if (! needsSaving) return;
+    
+    juce::XmlElement xml ("MIXER");
+    for (juce::HashMap<juce::String, LayerMixSettings>::Iterator i (settings); i.next();) {
+        auto* layer = xml.createNewChildElement("LAYER");
+        layer->setAttribute("file", i.getKey());
+        layer->setAttribute("gain", i.getValue().gain);
+        layer->setAttribute("pan", i.getValue().pan);
+        layer->setAttribute("mute", i.getValue().mute);
+        layer->setAttribute("solo", i.getValue().solo);
+    }
+    
+    file.getParentDirectory().createDirectory();
+    if (xml.writeTo(file))
+        needsSaving = false;
+}
+
 
 //===================================== Project =========================================
 
@@ -30,14 +123,25 @@ juce::File& Layer::getFile() { return layerFile; }
 // I would not create a default constructor like this. This should never be called. - Nolan
 Project::Project() : layers(), mixdownFile(juce::File()) {}
 
-Project::Project(juce::File& mixdownFile) : mixdownFile(mixdownFile) {
+Project::Project(juce::File& mixdownFile, juce::AudioFormatManager& formatManager) : mixdownFile(mixdownFile) {
     if (mixdownFile.isDirectory()) throw "Invalid mixdownFile given; mixdownFile is a directory";
-    // Check this mixdownFile's containing directory for a sub-directory with the same name
-    // as the mixdownFile (minus the audio file extension).
-    juce::File layersDir = mixdownFile.withFileExtension(juce::StringRef()); // potential layers directory
+    adoptLegacyLayerDirectory(formatManager);
+    
+    // Check this mixdownFile's containing directory for a sub-directory named after the mixdownFile
+    juce::File layersDir = getLayerDirectoryFor(mixdownFile); // potential layers directory
     if (layersDir.isDirectory()) {
         juce::Array<juce::File> children = layersDir.findChildFiles(juce::File::findFiles, false);
         for (juce::File child : children) {
+            // Skips the project's mix settings, along with anything else that isn't audio (temporary files,
+            // .DS_Store and the like)
+            if (formatManager.findFormatForFileExtension(child.getFileExtension()) == nullptr) continue;
+            
+            // Recover layers whose recording was cut short. Files touched in the last few seconds may
+            // still be being recorded, and their headers are kept up to date by the writer.
+            if (child.hasFileExtension(".wav")
+                && child.getLastModificationTime() < juce::Time::getCurrentTime() - juce::RelativeTime::seconds(5))
+                ProjectManagement::repairTruncatedWav(child);
+            
             layers.add(Layer(child));
         }
     }
@@ -50,13 +154,33 @@ juce::String Project::getName() {
 juce::File& Project::getMixdownFile() { return mixdownFile; }
 
 juce::File Project::getLayerDirectory() {
-    return mixdownFile.withFileExtension(juce::StringRef());
+    return getLayerDirectoryFor(mixdownFile);
+}
+
+juce::File Project::getLayerDirectoryFor(const juce::File& mixdownFile) {
+    return mixdownFile.getSiblingFile(mixdownFile.getFileName() + ".layers");
+}
+
+void Project::adoptLegacyLayerDirectory(juce::AudioFormatManager& formatManager) {
+    // Layers used to be kept in a directory named after the mixdown without its extension, which mixdowns
+    // differing only in format had to share. It's only moved when there's no doubt which mixdown it belongs to.
+    juce::File legacyDir = mixdownFile.withFileExtension(juce::StringRef());
+    if (! legacyDir.isDirectory() || getLayerDirectory().exists()) return;
+    
+    juce::Array<juce::File> namesakes = mixdownFile.getParentDirectory().findChildFiles(juce::File::findFiles, false,
+                                                                                        legacyDir.getFileName() + ".*");
+    for (juce::File namesake : namesakes)
+        if (namesake != mixdownFile && formatManager.findFormatForFileExtension(namesake.getFileExtension()) != nullptr)
+            return;
+    
+    legacyDir.moveFileTo(getLayerDirectory());
 }
 
 juce::File Project::createNewLayer() {
     juce::File layerFile = getLayerDirectory().getNonexistentChildFile("layer_" + std::to_string(getNumLayers() + 1), ".wav");
     layerFile.create();
     layers.add(Layer(layerFile));
+    layersChanged();
     return layerFile;
 }
 
@@ -66,15 +190,119 @@ juce::File Project::getLastLayerFile() {
 
 int Project::getNumLayers() { return layers.size(); }
 
+ProjectMixer& Project::getMixer() {
+    if (mixer == nullptr)
+        mixer = std::make_shared<ProjectMixer>(getMixerFile(mixdownFile));
+    return *mixer;
+}
+
+juce::File Project::getMixerFile(const juce::File& mixdownFile) {
+    return getLayerDirectoryFor(mixdownFile).getChildFile("mixer.xml");
+}
+
+int Project::getRevision() const noexcept {
+    // Loading the mixer changes nothing it mixes, so it only counts once it's been edited
+    return revision + (mixer != nullptr ? mixer->getRevision() : 0);
+}
+
 
 //===================================== ProjectManagement =========================================
 
-juce::Array<Project> ProjectManagement::getAllProjectsInFolder(juce::File &mixdownFolder) {
+juce::Array<Project> ProjectManagement::getAllProjectsInFolder(juce::File &mixdownFolder, juce::AudioFormatManager& formatManager) {
     juce::Array<Project> projects;
     juce::Array<juce::File> children = mixdownFolder.findChildFiles(juce::File::findFiles, false);
     for (juce::File child : children) {
-        if (child.getFileExtension().equalsIgnoreCase(".wav"))
-            projects.add(Project(child));
+        if (formatManager.findFormatForFileExtension(child.getFileExtension()) != nullptr)
+            projects.add(Project(child, formatManager));
     }
     return projects;
 }
+
+bool ProjectManagement::repairTruncatedWav(const juce::File& wavFile) {
+    const juce::int64 fileSize = wavFile.getSize();
+    juce::int64 riffSize = 0, dataSizePosition = -1, dataStart = 0, dataSize = 0;
+    juce::int64 ds64Position = -1, junkPosition = -1; // positions of chunk data
+    int blockAlign = 1;
+    bool isRF64 = false;
+    
+    {
+        juce::FileInputStream in (wavFile);
+        if (in.failedToOpen() || fileSize < 12) return false;
+        
+        char id[4];
+        in.read(id, 4);
+        isRF64 = memcmp(id, "RF64", 4) == 0;
+        if (! isRF64 && memcmp(id, "RIFF", 4) != 0) return false;
+        riffSize = (juce::uint32) in.readInt();
+        in.read(id, 4);
+        if (memcmp(id, "WAVE", 4) != 0) return false;
+        
+        // Walk the chunks until we find the audio
+        while (in.getPosition() + 8 <= fileSize) {
+            in.read(id, 4);
+            juce::int64 chunkSize = (juce::uint32) in.readInt();
+            const juce::int64 chunkStart = in.getPosition();
+            
+            if (memcmp(id, "ds64", 4) == 0) {
+                ds64Position = chunkStart;
+                riffSize = in.readInt64();
+                dataSize = in.readInt64();
+            } else if (memcmp(id, "JUNK", 4) == 0 && chunkSize >= 28) {
+                junkPosition = chunkStart;
+            } else if (memcmp(id, "fmt ", 4) == 0) {
+                in.setPosition(chunkStart + 12);
+                blockAlign = juce::jmax(1, (int) in.readShort());
+            } else if (memcmp(id, "data", 4) == 0) {
+                dataSizePosition = chunkStart - 4;
+                dataStart = chunkStart;
+                if (! isRF64) dataSize = chunkSize; // otherwise the real size came from ds64
+                break;
+            }
+            
+            in.setPosition(chunkStart + chunkSize + (chunkSize & 1));
+        }
+    }
+    
+    if (dataSizePosition < 0 || (isRF64 && ds64Position < 0)) return false;
+    
+    // Only whole sample frames are kept
+    juce::int64 available = fileSize - dataStart;
+    available -= available % blockAlign;
+    const juce::int64 newRiffSize = dataStart + available - 8;
+    
+    if (dataSize == available && riffSize == newRiffSize) return false; // intact
+    
+    // A take that crashed after passing 4 GB but before its header was promoted: turn the JUNK chunk that
+    // JUCE reserves for this into a ds64 chunk, the same way the writer would have
+    if (! isRF64 && newRiffSize > (juce::int64) 0xffffffff) {
+        if (junkPosition < 0) return false;
+        isRF64 = true;
+        ds64Position = junkPosition;
+    }
+    
+    juce::FileOutputStream out (wavFile);
+    if (out.failedToOpen()) return false;
+    
+    if (isRF64) {
+        out.setPosition(0);
+        out.write("RF64", 4);
+        out.writeInt(-1);
+        out.setPosition(ds64Position - 8);
+        out.write("ds64", 4);
+        out.setPosition(ds64Position);
+        out.writeInt64(newRiffSize);
+        out.writeInt64(available);
+        out.writeInt64(available / blockAlign); // sample count
+        out.writeInt(0);                        // table length
+        out.setPosition(dataSizePosition);
+        out.writeInt(-1);
+    } else {
+        out.setPosition(4);
+        out.writeInt((int) (juce::uint32) newRiffSize);
+        out.setPosition(dataSizePosition);
+        out.writeInt((int) (juce::uint32) available);
+    }
+    
+    out.flush();
+    return true;
+}
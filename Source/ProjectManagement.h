@@ -21,8 +21,87 @@ public:
     
     juce::File& getFile();
     
+    /**
+     Return the sample, at this Layer's own sample rate, at which it starts relative to the beginning of its
+     Project's mixdown. Read from the file's BWF time reference the first time it is asked for; layers without
+     one (including older layers padded with silence) start at 0.
+     */
+    juce::int64 getStartSample();
+    
+    /**
+     Return this Layer's start position relative to its Project's mixdown, in seconds.
+     */
+    double getStartTime();
+    
+    /**
+     Create the WAV metadata that records a layer's start position.
+     @param startSample     Offset into the mixdown, in samples at the layer's sample rate.
+     @return    Metadata to pass to WavAudioFormat::createWriterFor().
+     */
+    static juce::StringPairArray createMetadata(juce::int64 startSample);
+    
 private:
+    void readHeader();
+    
     juce::File layerFile;
+    
+    // Cached from the file header
+    bool headerRead = false;
+    juce::int64 startSample = 0;
+    double sampleRate = 0.0;
+};
+
+
+/**
+ How one layer sits in its project's mix.
+ */
+struct LayerMixSettings {
+    float gain = 1.0f;  // linear
+    float pan = 0.0f;   // -1 (left) to 1 (right)
+    bool mute = false;
+    bool solo = false;
+    
+    /**
+     Work out the gains this layer's left and right channels play at, using an equal-power pan law that is
+     unity in the centre.
+     @param anySoloed   Whether any layer in the project is soloed, which silences every layer that isn't.
+     */
+    void getChannelGains(bool anySoloed, float& left, float& right) const;
+};
+
+
+/**
+ The mix settings for every layer of a Project, saved as XML in its layer directory.
+ */
+class ProjectMixer {
+public:
+    /**
+     Load a project's mix settings. A missing or unreadable file leaves every layer at its defaults.
+     @param settingsFile    The file the settings are kept in.
+     */
+    explicit ProjectMixer(const juce::File& settingsFile);
+    
+    LayerMixSettings getSettings(const juce::File& layerFile) const;
+    void setSettings(const juce::File& layerFile, const LayerMixSettings& newSettings);
+    
+    bool isAnySoloed() const;
+    
+    /**
+     Return a count that goes up every time a layer's settings change, so that anything mixed from them can
+     tell it's out of date without comparing every layer.
+     */
+    int getRevision() const noexcept { return revision; }
+    
+    /**
+     Write the settings to disk if they've changed since they were loaded or last saved.
+     */
+    void save();
+    
+private:
+    juce::File file;
+    juce::HashMap<juce::String, LayerMixSettings> settings; // keyed by layer file name
+    bool needsSaving = false;
+    int revision = 0;
 };
 
 
@@ -32,11 +111,12 @@ public:
     Project();
     
     /**
-     Create a new Project.
+     Create a new Project, with a Layer for every audio file in its layer directory.
      @throws Invalid mixdownFile exception if mixdownFile is a directory.
-     @param mixdownFile The file in which this Project's mixdown is stored.
+     @param mixdownFile     The file in which this Project's mixdown is stored.
+     @param formatManager   The formats a file in the layer directory may be in to count as a Layer.
      */
-    Project(juce::File& mixdownFile);
+    Project(juce::File& mixdownFile, juce::AudioFormatManager& formatManager);
     
     /**
      Return the name of this Project, which is based on its mixdown.
@@ -55,6 +135,13 @@ public:
      */
     juce::File getLayerDirectory();
     
+    /**
+     Return the directory a Project's Layers live in: the mixdown's full file name, extension included, with
+     ".layers" after it, so that mixdowns differing only in format each have their own.
+     @param mixdownFile The Project's mixdown file.
+     */
+    static juce::File getLayerDirectoryFor(const juce::File& mixdownFile);
+    
     /**
      Creates and returns a new layer for this Project.
      */
@@ -67,12 +154,47 @@ public:
      */
     int getNumLayers();
     
+    /**
+     Get this Project's mix settings, loading them from its layer directory the first time they're asked for.
+     */
+    ProjectMixer& getMixer();
+    
+    /**
+     Return this Project's mix settings if they've been loaded, or nullptr if they haven't been asked for yet.
+     */
+    const ProjectMixer* getLoadedMixer() const noexcept { return mixer.get(); }
+    
+    /**
+     Return the file a Project's mix settings are kept in.
+     @param mixdownFile The Project's mixdown file.
+     */
+    static juce::File getMixerFile(const juce::File& mixdownFile);
+    
+    /**
+     Return a count that goes up whenever this Project's layers or their mix settings change. Cheap to ask for,
+     so it can be checked every time something mixed from the Project is about to be reused.
+     */
+    int getRevision() const noexcept;
+    
+    /**
+     Note that the layers array has been changed from outside, so that getRevision() moves on.
+     */
+    void layersChanged() noexcept { ++revision; }
+    
     // The layers which this Project contains. Open for manipulation from outsiders,
     // at least for now, to make for ease of use.
     juce::Array<Layer> layers;
     
 private:
+    /**
+     Move a layer directory named after the mixdown without its extension to getLayerDirectory(), as long as
+     no other mixdown could claim it.
+     */
+    void adoptLegacyLayerDirectory(juce::AudioFormatManager& formatManager);
+    
     juce::File mixdownFile;
+    std::shared_ptr<ProjectMixer> mixer; // shared, since Projects are copied into arrays
+    int revision = 0;
 };
 
 
@@ -83,14 +205,29 @@ class ProjectManagement {
 public:
     /**
      Generate Projects from a given mixdown folder. Assumes that the folder specified has mixdown audio files in its root
-     and layers for each project in subfolders with names identicle to their associated mixdown file (minus the file extension).
+     and layers for each project in subfolders named after their associated mixdown file (see Project::getLayerDirectoryFor()).
      
      For example, with a mixdown named "mixd.wav", we expect a subfolder within "mixd.wav"'s containing folder to be named
-     "mixd/" and contain the audio layers for the mixd project. If there is no such subfolder, it is assumed that this project
-     has no layers (yet).
+     "mixd.wav.layers/" and contain the audio layers for the mixd project. If there is no such subfolder, it is assumed that
+     this project has no layers (yet).
+     
+     Mixdowns may be in any format the given AudioFormatManager can read, so compressed ones (FLAC, Ogg Vorbis, MP3)
+     count as well as WAV and AIFF.
      
      @param mixdownFolder   The folder to generate mixdowns from.
+     @param formatManager   The formats a file may be in to count as a mixdown.
      @return    A list of Projects found in given directory.
      */
-    static juce::Array<Project> getAllProjectsInFolder(juce::File& mixdownFolder);
+    static juce::Array<Project> getAllProjectsInFolder(juce::File& mixdownFolder, juce::AudioFormatManager& formatManager);
+    
+    /**
+     Repair a WAV file whose take was interrupted (by a crash or power loss) before its header was finalised.
+     The RIFF and data chunk sizes are extended to cover all complete sample frames actually on disk, or
+     shrunk if the file is shorter than its header claims. Assumes, as for layers Spark records, that the
+     data chunk is the last chunk in the file.
+     
+     @param wavFile     The file to check.
+     @return    True if the file needed repairing and was repaired.
+     */
+    static bool repairTruncatedWav(const juce::File& wavFile);
 };
@@ -0,0 +1,426 @@
+/*
+  ==============================================================================
+
+    ProjectMixSource.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "ProjectMixSource.h"
+
+
+//===================================== Snapshot =========================================
+
+ProjectMixSource::Snapshot::Snapshot(Project& project)
+    : mixdownFile(project.getMixdownFile()), headers(project.layers) {
+    // Settings the project already has are copied now, since they may be changed before they're saved. Ones it
+    // hasn't loaded are read from the same file later, away from the message thread.
+    const auto* mixer = project.getLoadedMixer();
+    gainsKnown = mixer != nullptr;
+    const bool anySoloed = gainsKnown && mixer->isAnySoloed();
+
+    for (auto& layer : headers) {
+        LayerState state;
+        state.file = layer.getFile();
+        if (gainsKnown)
+            mixer->getSettings(state.file).getChannelGains(anySoloed, state.leftGain, state.rightGain);
+        layers.add(state);
+    }
+}
+
+void ProjectMixSource::Snapshot::readFiles() {
+    if (! gainsKnown) {
+        const ProjectMixer savedMixer (Project::getMixerFile(mixdownFile));
+        const bool anySoloed = savedMixer.isAnySoloed();
+
+        for (auto& state : layers)
+            savedMixer.getSettings(state.file).getChannelGains(anySoloed, state.leftGain, state.rightGain);
+        gainsKnown = true;
+    }
+
+    for (int i = 0; i < layers.size(); ++i)
+        layers.getReference(i).startTime = headers.getReference(i).getStartTime();
+}
+
+
+//===================================== ProjectMixSource =========================================
+
+ProjectMixSource::ProjectMixSource(juce::AudioFormatManager& manager, juce::TimeSliceThread& readAheadThread,
+                                   ResamplingQuality resamplingQuality, double resampleRate)
+    : formatManager(manager), thread(readAheadThread), quality(resamplingQuality), preResampleRate(resampleRate) {
+    thread.addTimeSliceClient(this);
+}
+
+ProjectMixSource::~ProjectMixSource() {
+    thread.removeTimeSliceClient(this);
+    activeSet = nullptr;
+    callbackEpoch.waitForCallbackToFinish();
+}
+
+bool ProjectMixSource::loadProject(const Snapshot& project) {
+    auto set = std::make_unique<StreamSet>();
+    set->generation = nextGeneration++;
+
+    auto mixdown = createStream(project.mixdownFile);
+    if (mixdown == nullptr) return false;
+
+    // The timeline runs at the mixdown's sample rate, or the one everything's resampled to ahead of time.
+    // Any file at another rate is resampled as it plays.
+    const double rate = preResampleRate > 0.0 ? preResampleRate : mixdown->sampleRate;
+    if (rate <= 0.0 || ! canResample(mixdown->sampleRate, rate)) return false;
+    resampleStream(*mixdown, rate);
+    set->streams.add(mixdown.release());
+
+    juce::Array<juce::File> files { juce::File() };
+    juce::Array<juce::File> unplayable;
+    juce::Array<GainChange> gains;
+    gains.add({ set->generation, 0, 1.0f, 1.0f });
+    
+    for (auto& layer : project.layers) {
+        if (auto stream = createStream(layer.file)) {
+            // Played unconverted, a layer would run at the wrong speed, so it's left out instead
+            if (! canResample(stream->sampleRate, rate)) {
+                unplayable.add(layer.file);
+                continue;
+            }
+
+            resampleStream(*stream, rate);
+            stream->start = (juce::int64) std::llround(layer.startTime * rate);
+            
+            GainChange levels { set->generation, set->streams.size(), layer.leftGain, layer.rightGain };
+            stream->leftGain.setCurrentAndTargetValue(levels.left);
+            stream->rightGain.setCurrentAndTargetValue(levels.right);
+            
+            set->streams.add(stream.release());
+            files.add(layer.file);
+            gains.add(levels);
+        }
+    }
+
+    for (auto* stream : set->streams) {
+        set->maxChannels = juce::jmax(set->maxChannels, stream->numChannels);
+        set->totalLength = juce::jmax(set->totalLength, stream->start + stream->length);
+    }
+
+    // Get the new files reading from where playback is now, then swap them in. The old set keeps playing
+    // until the swap, so a reload doesn't interrupt anything.
+    seek(*set, nextReadPosition.load());
+    prefetch(*set, nextReadPosition.load());
+    if (blockSize > 0) prepare(*set);
+
+    timelineRate = rate;
+    totalLength = set->totalLength;
+    activeSet = set.get();
+    callbackEpoch.waitForCallbackToFinish();
+    {
+        const juce::ScopedLock sl (streamSetLock);
+        streamSet = std::move(set);
+    }
+    streamFiles = files;
+    currentGains = gains;
+    unplayableLayers = unplayable;
+    return true;
+}
+
+void ProjectMixSource::updateMix(Project& project) {
+    auto& mixer = project.getMixer();
+    const bool anySoloed = mixer.isAnySoloed();
+    
+    for (int i = 1; i < streamFiles.size(); ++i) {
+        GainChange levels { currentGains.getReference(i).generation, i, 0.0f, 0.0f };
+        mixer.getSettings(streamFiles.getReference(i)).getChannelGains(anySoloed, levels.left, levels.right);
+        
+        auto& current = currentGains.getReference(i);
+        if (levels.left != current.left || levels.right != current.right) {
+            pushGainChange(levels);
+            current = levels;
+        }
+    }
+}
+
+void ProjectMixSource::pushGainChange(const GainChange& change) {
+    int start1, size1, start2, size2;
+    gainFifo.prepareToWrite(1, start1, size1, start2, size2);
+    
+    // The audio thread drains the queue every block, so it only fills up if playback has stalled
+    jassert (size1 + size2 == 1);
+    if (size1 > 0) gainQueue[start1] = change;
+    else if (size2 > 0) gainQueue[start2] = change;
+    
+    gainFifo.finishedWrite(size1 + size2);
+}
+
+void ProjectMixSource::applyGainChanges(StreamSet& set) noexcept {
+    int start1, size1, start2, size2;
+    gainFifo.prepareToRead(gainFifo.getNumReady(), start1, size1, start2, size2);
+    
+    auto apply = [&set] (const GainChange& change) {
+        // Changes queued for the set that was just replaced are dropped. The new set was built with the latest
+        // levels, and its streams needn't line up with the old one's.
+        if (change.generation != set.generation) return;
+
+        if (auto* stream = set.streams[change.stream]) {
+            stream->leftGain.setTargetValue(change.left);
+            stream->rightGain.setTargetValue(change.right);
+        }
+    };
+    
+    for (int i = 0; i < size1; ++i) apply(gainQueue[start1 + i]);
+    for (int i = 0; i < size2; ++i) apply(gainQueue[start2 + i]);
+    
+    gainFifo.finishedRead(size1 + size2);
+}
+
+std::unique_ptr<ProjectMixSource::Stream> ProjectMixSource::createStream(const juce::File& file) {
+    auto stream = std::make_unique<Stream>();
+
+    auto playFromCache = [&stream] (std::shared_ptr<const DecodedAudio> decoded) {
+        stream->numChannels = decoded->samples.getNumChannels();
+        stream->length = decoded->samples.getNumSamples();
+        stream->sampleRate = decoded->sampleRate;
+        stream->source = std::make_unique<CachedAudioSource>(std::move(decoded));
+        return std::move(stream);
+    };
+
+    // A copy resampled ahead of time saves resampling as it plays
+    const bool preResampling = preResampleRate > 0.0;
+    if (preResampling)
+        if (auto decoded = decodedCache->find(file, preResampleRate))
+            return playFromCache(std::move(decoded));
+
+    if (auto mapped = MappedAudioSource::create(file, formatManager, thread)) {
+        auto& reader = mapped->getReader();
+        stream->numChannels = (int) reader.numChannels;
+        stream->length = reader.lengthInSamples;
+        stream->sampleRate = reader.sampleRate;
+        stream->mapped = mapped.get();
+        stream->source = std::move(mapped);
+
+        if (preResampling && stream->sampleRate != preResampleRate)
+            decodedCache->decodeInBackground(file, preResampleRate);
+        return stream;
+    }
+
+    // Other files have to be decoded, so recently played ones are kept decoded in memory
+    if (! preResampling)
+        if (auto decoded = decodedCache->find(file))
+            return playFromCache(std::move(decoded));
+
+    // Until it's in the cache, the file is decoded ahead of playback. Compressed files are decoded further
+    // ahead, on a thread of their own.
+    if (auto streaming = StreamingAudioSource::create(file, formatManager)) {
+        decodedCache->decodeInBackground(file, preResampleRate);
+
+        auto& reader = streaming->getReader();
+        stream->numChannels = (int) reader.numChannels;
+        stream->length = reader.lengthInSamples;
+        stream->sampleRate = reader.sampleRate;
+        stream->source = std::move(streaming);
+        return stream;
+    }
+
+    std::unique_ptr<juce::AudioFormatReader> reader (formatManager.createReaderFor(file));
+    if (reader == nullptr || reader->lengthInSamples <= 0) return nullptr;
+    decodedCache->decodeInBackground(file, preResampleRate);
+
+    stream->numChannels = (int) reader->numChannels;
+    stream->length = reader->lengthInSamples;
+    stream->sampleRate = reader->sampleRate;
+
+    const int readAhead = (int) juce::jmax(32768.0, reader->sampleRate); // a second of audio
+    stream->source = std::make_unique<juce::BufferingAudioSource>(new juce::AudioFormatReaderSource(reader.release(), true),
+                                                                  thread, true, readAhead, stream->numChannels);
+    return stream;
+}
+
+bool ProjectMixSource::canResample(double fileRate, double timelineRate) noexcept {
+    if (fileRate == timelineRate) return true;
+    if (fileRate <= 0.0 || timelineRate <= 0.0) return false;
+
+    const double ratio = fileRate / timelineRate;
+    return ratio <= maxRateRatio && ratio >= 1.0 / maxRateRatio;
+}
+
+void ProjectMixSource::resampleStream(Stream& stream, double rate) {
+    if (stream.sampleRate == rate) return;
+
+    auto resampling = std::make_unique<SincResamplingSource>(stream.source.release(), true, stream.numChannels);
+    resampling->setQuality(quality);
+    resampling->setRates(stream.sampleRate, rate);
+
+    stream.length = resampling->getTotalLength();
+    stream.fileSamplesPerTimelineSample = stream.sampleRate / rate;
+    stream.source = std::move(resampling);
+}
+
+int ProjectMixSource::getNumStreams() const noexcept {
+    return streamSet != nullptr ? streamSet->streams.size() : 0;
+}
+
+void ProjectMixSource::prepare(StreamSet& set) {
+    set.scratch.setSize(set.maxChannels, blockSize);
+    set.ramps.setSize(2, blockSize);
+    
+    for (auto* stream : set.streams) {
+        stream->source->prepareToPlay(blockSize, deviceRate);
+        stream->leftGain.reset(deviceRate, gainRampTime);
+        stream->rightGain.reset(deviceRate, gainRampTime);
+    }
+}
+
+void ProjectMixSource::seek(StreamSet& set, juce::int64 position) {
+    for (auto* stream : set.streams)
+        stream->source->setNextReadPosition(juce::jlimit((juce::int64) 0, stream->length, position - stream->start));
+    set.position = position;
+}
+
+void ProjectMixSource::prefetch(StreamSet& set, juce::int64 position) {
+    for (auto* stream : set.streams)
+        if (stream->mapped != nullptr && position < stream->start + stream->length)
+            stream->mapped->prefetchAround(juce::jmax((juce::int64) 0, (juce::int64) ((position - stream->start)
+                                                                                     * stream->fileSamplesPerTimelineSample)));
+}
+
+void ProjectMixSource::prefetchAt(juce::int64 position) {
+    const juce::ScopedLock sl (streamSetLock);
+    if (streamSet != nullptr) prefetch(*streamSet, position);
+}
+
+int ProjectMixSource::useTimeSlice() {
+    const auto position = pendingPrefetch.exchange(-1);
+    if (position < 0) return 20;
+
+    const juce::ScopedLock sl (streamSetLock);
+    if (streamSet != nullptr) prefetch(*streamSet, position);
+    return 0; // in case there's been another seek meanwhile
+}
+
+//==============================================================================
+void ProjectMixSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    // Mixes are often prepared ahead of time, in which case there's nothing left to do
+    if (isPreparedFor(samplesPerBlockExpected, sampleRate)) return;
+
+    blockSize = samplesPerBlockExpected;
+    deviceRate = sampleRate;
+    if (streamSet != nullptr) prepare(*streamSet);
+}
+
+void ProjectMixSource::releaseResources() {
+    if (streamSet != nullptr)
+        for (auto* stream : streamSet->streams)
+            stream->source->releaseResources();
+    blockSize = 0;
+}
+
+void ProjectMixSource::setNextReadPosition(juce::int64 newPosition) {
+    // Seeks come from the transport on the audio thread, so the streams are moved straight away and any that
+    // read ahead start on the new position now, rather than when they next play (which, while a loop's start
+    // plays from memory, is a while later). Whoever asked for the seek has paged in the new position with
+    // prefetchAt() already; the read-ahead thread does it again in case pages were dropped since.
+    const CallbackEpoch::ScopedCallback inCallback (callbackEpoch);
+    nextReadPosition = newPosition;
+    if (auto* set = activeSet.load()) seek(*set, newPosition);
+    pendingPrefetch = newPosition;
+}
+
+juce::int64 ProjectMixSource::getTotalLength() const {
+    return totalLength.load();
+}
+
+void ProjectMixSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    const CallbackEpoch::ScopedCallback inCallback (callbackEpoch);
+    bufferToFill.clearActiveBufferRegion();
+
+    auto position = nextReadPosition.load();
+
+    auto* set = activeSet.load();
+
+    if (set != nullptr && set->scratch.getNumSamples() > 0) {
+        applyGainChanges(*set);
+        if (set->position != position) seek(*set, position);
+
+        // A block larger than announced is mixed in pieces the scratch buffer can hold
+        const int maxBlock = set->scratch.getNumSamples();
+        for (int done = 0; done < bufferToFill.numSamples;) {
+            const int num = juce::jmin(maxBlock, bufferToFill.numSamples - done);
+            mixBlock(*set, *bufferToFill.buffer, bufferToFill.startSample + done, num);
+            done += num;
+        }
+    }
+
+    // If the message thread seeked while we were mixing, its position wins
+    nextReadPosition.compare_exchange_strong(position, position + bufferToFill.numSamples);
+}
+
+void ProjectMixSource::mixBlock(StreamSet& set, juce::AudioBuffer<float>& dest, int destStart, int numSamples) {
+    const auto blockStart = set.position;
+    const auto blockEnd = blockStart + numSamples;
+
+    for (auto* stream : set.streams) {
+        // Streams only do any work in the blocks they overlap, though their gain ramps keep time regardless
+        const auto from = juce::jmax(blockStart, stream->start);
+        const auto to = juce::jmin(blockEnd, stream->start + stream->length);
+        const int num = (int) juce::jmax((juce::int64) 0, to - from);
+
+        if (num > 0) {
+            juce::AudioBuffer<float> view (set.scratch.getArrayOfWritePointers(), stream->numChannels, num);
+            stream->source->getNextAudioBlock(juce::AudioSourceChannelInfo(view));
+            mixInto(dest, destStart + (int) (from - blockStart), view, *stream, set.ramps, num);
+        }
+
+        stream->leftGain.skip(numSamples - num);
+        stream->rightGain.skip(numSamples - num);
+    }
+
+    set.position = blockEnd;
+}
+
+void ProjectMixSource::mixInto(juce::AudioBuffer<float>& dest, int destStart, const juce::AudioBuffer<float>& source,
+                               Stream& stream, juce::AudioBuffer<float>& ramps, int numSamples) noexcept {
+    // While a level is changing, each side gets a per-sample gain ramp; otherwise a single gain will do
+    const float gains[2] = { stream.leftGain.getCurrentValue(), stream.rightGain.getCurrentValue() };
+    const float* gainRamps[2] = { nullptr, nullptr };
+    
+    if (stream.leftGain.isSmoothing() || stream.rightGain.isSmoothing()) {
+        juce::SmoothedValue<float>* sides[2] = { &stream.leftGain, &stream.rightGain };
+        for (int side = 0; side < 2; ++side) {
+            auto* ramp = ramps.getWritePointer(side);
+            for (int i = 0; i < numSamples; ++i)
+                ramp[i] = sides[side]->getNextValue();
+            gainRamps[side] = ramp;
+        }
+    } else if (gains[0] == 0.0f && gains[1] == 0.0f) {
+        return; // muted
+    }
+    
+    addPanned(dest, destStart, source, stream.numChannels, gains, gainRamps, numSamples);
+}
+
+void ProjectMixSource::addPanned(juce::AudioBuffer<float>& dest, int destStart, const juce::AudioBuffer<float>& source,
+                                 int numSourceChannels, const float* gains, const float* const* gainRamps,
+                                 int numSamples) noexcept {
+    const int numDestChannels = dest.getNumChannels();
+    if (numDestChannels == 0 || numSourceChannels == 0) return;
+    
+    auto add = [&] (int destChannel, int sourceChannel, int side) {
+        auto* d = dest.getWritePointer(destChannel, destStart);
+        auto* s = source.getReadPointer(sourceChannel);
+        if (gainRamps[side] != nullptr)
+            juce::FloatVectorOperations::addWithMultiply(d, s, gainRamps[side], numSamples);
+        else
+            juce::FloatVectorOperations::addWithMultiply(d, s, gains[side], numSamples);
+    };
+
+    // Even outputs are on the left, odd ones on the right
+    if (numSourceChannels == 1) {
+        for (int ch = 0; ch < numDestChannels; ++ch)
+            add(ch, 0, ch % 2);
+        return;
+    }
+
+    // Surplus source channels fold back onto the outputs
+    for (int ch = 0; ch < numSourceChannels; ++ch)
+        add(ch % numDestChannels, ch, ch % 2);
+}
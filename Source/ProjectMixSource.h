@@ -0,0 +1,238 @@
+/*
+  ==============================================================================
+
+    ProjectMixSource.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Plays a Project's mixdown together with all of its layers.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectManagement.h"
+#include "RealtimeSync.h"
+#include "MappedAudioSource.h"
+#include "DecodedAudioCache.h"
+#include "StreamingAudioSource.h"
+#include "SincResampler.h"
+
+
+/**
+ A PositionableAudioSource that streams a project's mixdown and every one of its layers at once, each placed
+ on the mixdown's timeline by its start offset, and sums them into one output at the levels set in the
+ project's ProjectMixer.
+
+ Uncompressed files are played straight from memory-mapped storage through a MappedAudioSource, with the
+ pages around the playhead faulted in ahead of time; any others are read ahead on a shared background thread
+ through their own BufferingAudioSource while they're decoded into the shared DecodedAudioCache, from which
+ they're played the next time. Compressed files are streamed further ahead, on a thread of their own, through
+ a StreamingAudioSource. Files at a different rate than the timeline are resampled as they play by a
+ SincResamplingSource, unless they've been resampled ahead of time. Either way the audio thread never waits
+ on the disk. Mixing is done with juce::FloatVectorOperations, and a layer only costs anything in the blocks
+ it actually overlaps, so large numbers of layers stay cheap.
+
+ The set of files being played can be replaced at any time (for example once a new take has been recorded)
+ without stopping playback: a new set is built on the message thread and swapped in wait-free. Mix changes
+ reach the audio thread through a lock-free queue, and every gain change is ramped to avoid clicks.
+ */
+class ProjectMixSource : public juce::PositionableAudioSource, public PrefetchableSource,
+                         private juce::TimeSliceClient {
+public:
+    /**
+     Everything about a project that its mix plays: the files, where each layer starts, and the levels they're
+     mixed at. Taken in two steps: the message thread, which owns the Project and changes it as layers are
+     recorded or deleted, notes down what's in memory, and whichever thread loads the mix reads the rest from disk.
+     */
+    struct Snapshot {
+        /** One layer as it was when the snapshot was taken. */
+        struct LayerState {
+            juce::File file;
+            double startTime = 0.0; // seconds into the mixdown
+            float leftGain = 1.0f, rightGain = 1.0f;
+        };
+
+        Snapshot() = default;
+
+        /**
+         Note down a project's files, and its mix settings if they've been loaded. Nothing is read from disk, so
+         this is cheap enough to do on the message thread, which is the only one it may be done on.
+         */
+        explicit Snapshot(Project& project);
+
+        /**
+         Read what the snapshot still needs from disk: where each layer starts, and the mix settings if the
+         project hadn't loaded them. Can be called on any thread, and must be before the snapshot is loaded.
+         */
+        void readFiles();
+
+        juce::File mixdownFile;
+        juce::Array<LayerState> layers;
+
+    private:
+        juce::Array<Layer> headers; // copies of the project's layers, whose start times are read later
+        bool gainsKnown = false;    // false until the mix settings are read, if the project hadn't loaded them
+    };
+
+    /**
+     @param formatManager   Used to open the mixdown and layers.
+     @param readAheadThread The thread that reads every file ahead of playback, or pages it in.
+     @param quality         How files at a different rate than the timeline are resampled as they play.
+     @param preResampleRate A rate for the timeline to run at, with every file resampled to it ahead of time in
+                            the DecodedAudioCache; or 0 for the mixdown's rate, with nothing resampled ahead of time.
+     */
+    ProjectMixSource(juce::AudioFormatManager& formatManager, juce::TimeSliceThread& readAheadThread,
+                     ResamplingQuality quality = ResamplingQuality::standard, double preResampleRate = 0.0);
+    ~ProjectMixSource() override;
+
+    /**
+     Start playing a project's mixdown and layers, replacing whatever was loaded. Playback carries on from the
+     same position. The project is only read through the snapshot, whose files must have been read, so this can
+     run on any thread. Layers that can't be read (such as one still being recorded) are skipped, as are any whose
+     sample rate can't be converted to the timeline's; those are listed by getUnplayableLayers().
+     @return    False if the mixdown couldn't be read or played, in which case nothing changes.
+     */
+    bool loadProject(const Snapshot& project);
+
+    /**
+     The layers left out by the last loadProject() because their sample rate is unknown, or too far from the
+     timeline's to be resampled to it.
+     */
+    const juce::Array<juce::File>& getUnplayableLayers() const noexcept { return unplayableLayers; }
+
+    /**
+     Bring playback in line with the project's mix settings after they've changed. Only the layers whose
+     levels actually changed are sent to the audio thread.
+     @param project     The project that was loaded.
+     */
+    void updateMix(Project& project);
+    
+    /**
+     The sample rate the whole timeline runs at: the loaded mixdown's, or the rate files are resampled to ahead
+     of time; 0 if nothing is loaded.
+     */
+    double getSampleRate() const noexcept { return timelineRate; }
+
+    /**
+     How many files (the mixdown included) are being played.
+     */
+    int getNumStreams() const noexcept;
+
+    /**
+     Whether a file at one rate can be played on a timeline at another. Files whose rate is unknown, or too far
+     from the timeline's, are left out of a mix rather than played at the wrong speed.
+     */
+    static bool canResample(double fileRate, double timelineRate) noexcept;
+
+    /** Pages in every memory-mapped file at a timeline position. Not for the audio thread. */
+    void prefetchAt(juce::int64 position) override;
+
+    /**
+     Whether the source has been prepared to play with these settings and not released since.
+     */
+    bool isPreparedFor(int samplesPerBlockExpected, double sampleRate) const noexcept {
+        return blockSize > 0 && blockSize == samplesPerBlockExpected && deviceRate == sampleRate;
+    }
+
+    /**
+     Add audio into a buffer the way every file in a project is mixed: mono goes to every channel, otherwise
+     each source channel goes to the matching output, with any surplus folded back onto the outputs. Even
+     outputs get the left gain, odd ones the right.
+     @param gains       The left and right gains.
+     @param gainRamps   Optional per-sample left and right gains, used in place of gains where not null.
+     */
+    static void addPanned(juce::AudioBuffer<float>& dest, int destStart, const juce::AudioBuffer<float>& source,
+                          int numSourceChannels, const float* gains, const float* const* gainRamps,
+                          int numSamples) noexcept;
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override { return nextReadPosition.load(); }
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override { return false; }
+
+private:
+    /** One file on the timeline. */
+    struct Stream {
+        std::unique_ptr<juce::PositionableAudioSource> source;
+        MappedAudioSource* mapped = nullptr; // the file's source, if it's played from memory-mapped storage
+        juce::int64 start = 0;  // position on the timeline of the file's first sample
+        juce::int64 length = 0; // on the timeline
+        int numChannels = 0;
+        double sampleRate = 0.0;
+        double fileSamplesPerTimelineSample = 1.0; // other than 1 if the file is resampled as it plays
+        juce::SmoothedValue<float> leftGain { 1.0f }, rightGain { 1.0f }; // only touched by the audio thread once published
+    };
+
+    /** Everything the audio thread plays, built on the message thread and published as a whole. */
+    struct StreamSet {
+        juce::OwnedArray<Stream> streams;
+        juce::AudioBuffer<float> scratch; // one block of any stream, so the audio thread never allocates
+        juce::AudioBuffer<float> ramps;   // per-sample left and right gains while a stream's level is changing
+        juce::int64 totalLength = 0;
+        juce::int64 position = -1;        // timeline position the streams are at; only touched by the audio thread
+        int maxChannels = 1;
+        int generation = 0;               // which load built the set, so stale gain changes can be told apart
+    };
+
+    std::unique_ptr<Stream> createStream(const juce::File& file);
+    void resampleStream(Stream& stream, double timelineRate);
+    void prepare(StreamSet& set);
+    void seek(StreamSet& set, juce::int64 position);
+    void prefetch(StreamSet& set, juce::int64 position);
+    int useTimeSlice() override;
+    void mixBlock(StreamSet& set, juce::AudioBuffer<float>& dest, int destStart, int numSamples);
+
+    /** Adds a stream's audio into the output at its current gains, spreading mono across every channel. */
+    static void mixInto(juce::AudioBuffer<float>& dest, int destStart, const juce::AudioBuffer<float>& source,
+                        Stream& stream, juce::AudioBuffer<float>& ramps, int numSamples) noexcept;
+    
+    /** A new level for one stream of the set built by a particular load. */
+    struct GainChange {
+        int generation;
+        int stream;
+        float left, right;
+    };
+    
+    void pushGainChange(const GainChange& change);
+    void applyGainChanges(StreamSet& set) noexcept;
+    
+    static constexpr double gainRampTime = 0.03; // seconds
+    static constexpr double maxRateRatio = 8.0;  // furthest a file's rate can be from the timeline's, either way
+
+    juce::AudioFormatManager& formatManager;
+    juce::TimeSliceThread& thread;
+    juce::SharedResourcePointer<DecodedAudioCache> decodedCache;
+    const ResamplingQuality quality;
+    const double preResampleRate;
+    double timelineRate = 0.0;
+
+    int blockSize = 0;
+    double deviceRate = 0.0;
+
+    std::unique_ptr<StreamSet> streamSet;
+    juce::CriticalSection streamSetLock; // held while the read-ahead thread pages in a seek's new position
+    std::atomic<juce::int64> pendingPrefetch { -1 };
+    std::atomic<StreamSet*> activeSet { nullptr };
+    std::atomic<juce::int64> nextReadPosition { 0 };
+    std::atomic<juce::int64> totalLength { 0 };
+    CallbackEpoch callbackEpoch;
+    
+    // Mix changes from the message thread. The files and levels of the active set are tracked here too, so
+    // only real changes get queued; stream 0 is always the mixdown, which isn't mixed.
+    juce::AbstractFifo gainFifo { 1024 };
+    juce::HeapBlock<GainChange> gainQueue { 1024 };
+    juce::Array<juce::File> streamFiles;
+    juce::Array<GainChange> currentGains;
+    int nextGeneration = 1;
+    juce::Array<juce::File> unplayableLayers;
+
+    JUCE_DECLARE_NON_COPYABLE (ProjectMixSource)
+};
@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    RealtimeSync.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Small synchronisation helpers for handing objects between the message
+    thread and the audio device thread without ever blocking the latter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+
+/**
+ A wait-free handshake between a single real-time callback and the threads that feed it.
+
+ The audio thread brackets every callback with a ScopedCallback, which bumps a counter on entry
+ and exit (odd while inside a callback). A non-real-time thread that has just unpublished an object
+ the callback may be using (by swapping an atomic pointer to something else) calls
+ waitForCallbackToFinish() before deleting it. Only the non-real-time side ever waits.
+ */
+class CallbackEpoch {
+public:
+    CallbackEpoch() = default;
+
+    /**
+     RAII guard to be placed at the top of an audio callback.
+     */
+    class ScopedCallback {
+    public:
+        explicit ScopedCallback(CallbackEpoch& e) noexcept : epoch(e) { epoch.counter.fetch_add(1); }
+        ~ScopedCallback() noexcept { epoch.counter.fetch_add(1); }
+
+    private:
+        CallbackEpoch& epoch;
+        JUCE_DECLARE_NON_COPYABLE (ScopedCallback)
+    };
+
+    /**
+     Waits until any callback that was running when this was called has returned. Callbacks that start
+     after this call are guaranteed to see whatever atomic stores preceded it.
+     Must never be called from the audio thread.
+     */
+    void waitForCallbackToFinish() const noexcept {
+        const auto start = counter.load();
+        if ((start & 1u) == 0) return; // not inside a callback
+
+        while (counter.load() == start)
+            juce::Thread::yield();
+    }
+
+private:
+    // All accesses are sequentially consistent: the pointer swap on the message thread and the
+    // counter increment on the audio thread must not be reordered with respect to each other.
+    std::atomic<juce::uint32> counter { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (CallbackEpoch)
+};
+
+
+/**
+ A source that can page in the audio at a position before it's seeked there, so that the audio thread, which
+ carries out the seek, never waits on the disk. Sources that play another pass the call on to it.
+ */
+class PrefetchableSource {
+public:
+    virtual ~PrefetchableSource() = default;
+
+    /**
+     Page in the audio just after a position, in this source's samples. This blocks, so it's for the thread
+     that's about to ask for the seek, never the audio thread.
+     */
+    virtual void prefetchAt(juce::int64 position) = 0;
+
+    /** Prefetch from any source that can, doing nothing for those that can't (or don't need to). */
+    static void prefetch(juce::PositionableAudioSource* source, juce::int64 position) {
+        if (auto* prefetchable = dynamic_cast<PrefetchableSource*>(source))
+            prefetchable->prefetchAt(position);
+    }
+};
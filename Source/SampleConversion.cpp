@@ -0,0 +1,122 @@
+/*
+  ==============================================================================
+
+    SampleConversion.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "SampleConversion.h"
+
+#if JUCE_USE_SSE_INTRINSICS
+ #include <emmintrin.h>
+#elif JUCE_USE_ARM_NEON
+ #include <arm_neon.h>
+#endif
+
+
+//===================================== DitheredIntConverter =========================================
+
+DitheredIntConverter::DitheredIntConverter(int bitsPerSample, int maxBlockSize)
+    : bits(bitsPerSample), scale((float) (1 << (bitsPerSample - 1))) {
+    jassert (bits > 8 && bits <= 24); // floats can't represent larger integers exactly
+
+    scratch.malloc(maxBlockSize);
+
+    // A prime table length keeps the noise from lining up with power-of-two block sizes
+    noiseLength = 8191;
+    noise.malloc(noiseLength + maxBlockSize);
+
+    juce::Random random(0x5eed);
+    for (int i = 0; i < noiseLength; ++i)
+        noise[i] = random.nextFloat() - random.nextFloat(); // triangular PDF spanning +/- 1 LSB
+    for (int i = 0; i < maxBlockSize; ++i)
+        noise[noiseLength + i] = noise[i % noiseLength];
+}
+
+void DitheredIntConverter::convert(int* dest, const float* source, int numSamples) noexcept {
+    const float maxValue = scale - 1.0f;
+    const int shift = 32 - bits;
+
+    // Scale to LSBs, add dither and clip, all vectorised
+    juce::FloatVectorOperations::multiply(scratch, source, scale, numSamples);
+    juce::FloatVectorOperations::add(scratch, noise + noisePosition, numSamples);
+    juce::FloatVectorOperations::clip(scratch, scratch, -scale, maxValue, numSamples);
+    noisePosition = (noisePosition + numSamples) % noiseLength;
+
+    int i = 0;
+
+   #if JUCE_USE_SSE_INTRINSICS
+    const auto shiftCount = _mm_cvtsi32_si128(shift);
+    for (; i + 4 <= numSamples; i += 4) {
+        auto rounded = _mm_cvtps_epi32(_mm_loadu_ps(scratch + i)); // round to nearest
+        _mm_storeu_si128((__m128i*) (dest + i), _mm_sll_epi32(rounded, shiftCount));
+    }
+   #elif JUCE_USE_ARM_NEON
+    const auto half = vdupq_n_f32(0.5f);
+    for (; i + 4 <= numSamples; i += 4) {
+        auto x = vld1q_f32(scratch + i);
+        // vcvtq truncates towards zero, so round half away from zero first
+        auto rounded = vcvtq_s32_f32(vaddq_f32(x, vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vnegq_f32(half), half)));
+        vst1q_s32(dest + i, vshlq_s32(rounded, vdupq_n_s32(shift)));
+    }
+   #endif
+
+    for (; i < numSamples; ++i)
+        dest[i] = juce::roundToInt(scratch[i]) * (1 << shift);
+}
+
+
+//==============================================================================
+juce::StringArray benchmarkConversion(double seconds) {
+    const int blockSize = 8192;
+    const int numBlocks = juce::jmax(1, (int) (seconds * 48000.0 / blockSize));
+    const double numSamples = (double) numBlocks * blockSize;
+
+    juce::HeapBlock<float> noise (blockSize);
+    juce::HeapBlock<int> output (blockSize);
+    juce::Random random;
+    for (int i = 0; i < blockSize; ++i)
+        noise[i] = random.nextFloat() * 2.0f - 1.0f;
+
+    juce::StringArray results;
+    volatile int lastSample = 0; // read after each run, so the conversions can't be optimised away
+
+    auto report = [&] (const juce::String& name, double startMs) {
+        const double ms = juce::Time::getMillisecondCounterHiRes() - startMs;
+        lastSample = output[blockSize / 2];
+        results.add(name.paddedRight(' ', 24) + juce::String(ms * 1.0e6 / numSamples, 2) + " ns a sample ("
+                    + juce::String(numSamples / 48000.0 / (ms / 1000.0), 0) + "x real time per channel)");
+    };
+
+    for (int bits : { 16, 24 }) {
+        // Scalar, dithering with a fresh random number per sample
+        {
+            const float scale = (float) (1 << (bits - 1));
+            const int shift = 32 - bits;
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+
+            for (int b = 0; b < numBlocks; ++b) {
+                for (int i = 0; i < blockSize; ++i) {
+                    const float dithered = noise[i] * scale + random.nextFloat() - random.nextFloat();
+                    output[i] = juce::roundToInt(juce::jlimit(-scale, scale - 1.0f, dithered)) * (1 << shift);
+                }
+            }
+            report("Scalar " + juce::String(bits) + "-bit", start);
+        }
+
+        {
+            DitheredIntConverter converter (bits, blockSize);
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+
+            for (int b = 0; b < numBlocks; ++b)
+                converter.convert(output, noise, blockSize);
+            report("Vectorised " + juce::String(bits) + "-bit", start);
+        }
+    }
+
+    juce::ignoreUnused(lastSample);
+    return results;
+}
@@ -0,0 +1,469 @@
+/*
+  ==============================================================================
+
+    SincResampler.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "SincResampler.h"
+
+#include <map>
+#include <mutex>
+
+#if JUCE_INTEL
+ #include <xmmintrin.h>
+#elif JUCE_ARM && defined (__ARM_NEON)
+ #include <arm_neon.h>
+#endif
+
+
+namespace {
+    /** The filter behind each quality level. */
+    struct QualitySettings {
+        int numTaps;        // a multiple of 8, for the vector loops
+        int numPhases;      // how finely the filter is tabulated between input samples
+        double beta;        // the Kaiser window's shape; larger trades a wider transition for a deeper stopband
+        double rolloff;     // the cutoff, as a share of the lower Nyquist frequency
+    };
+
+    QualitySettings getSettings(ResamplingQuality quality) noexcept {
+        switch (quality) {
+            case ResamplingQuality::draft:  return { 8, 128, 5.0, 0.85 };
+            case ResamplingQuality::best:   return { 64, 512, 9.5, 0.96 };
+            case ResamplingQuality::standard:
+            default:                        return { 24, 256, 7.0, 0.92 };
+        }
+    }
+
+    double besselI0(double x) noexcept {
+        const double quarterXSquared = x * x / 4.0;
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 64 && term > sum * 1.0e-12; ++k) {
+            term *= quarterXSquared / (k * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    /** Sum of a[i] * b[i]; n must be a multiple of 8. */
+    inline float dotProduct(const float* a, const float* b, int n) noexcept {
+       #if JUCE_INTEL
+        __m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+        for (int i = 0; i < n; i += 8) {
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+        }
+        sum0 = _mm_add_ps(sum0, sum1);
+        sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+        sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+        return _mm_cvtss_f32(sum0);
+       #elif JUCE_ARM && defined (__ARM_NEON)
+        float32x4_t sum0 = vdupq_n_f32(0.0f), sum1 = vdupq_n_f32(0.0f);
+        for (int i = 0; i < n; i += 8) {
+            sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+            sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        }
+        sum0 = vaddq_f32(sum0, sum1);
+        const float32x2_t halves = vadd_f32(vget_low_f32(sum0), vget_high_f32(sum0));
+        return vget_lane_f32(vpadd_f32(halves, halves), 0);
+       #else
+        float sums[4] = {};
+        for (int i = 0; i < n; i += 4)
+            for (int j = 0; j < 4; ++j)
+                sums[j] += a[i + j] * b[i + j];
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+       #endif
+    }
+}
+
+
+//===================================== Kernel =========================================
+
+/** The filter, tabulated at numPhases + 1 evenly spaced fractional positions, one row of taps each. */
+struct SincResampler::Kernel {
+    int numTaps = 0, numPhases = 0;
+    juce::HeapBlock<float> table;
+
+    const float* getRow(int phase) const noexcept { return table + phase * numTaps; }
+};
+
+std::shared_ptr<const SincResampler::Kernel> SincResampler::getKernel(ResamplingQuality quality, double cutoff) {
+    static std::mutex lock;
+    static std::map<std::pair<int, int>, std::weak_ptr<const Kernel>> kernels;
+
+    const std::lock_guard<std::mutex> sl (lock);
+    auto& cached = kernels[{ (int) quality, juce::roundToInt(cutoff * 1.0e6) }];
+    if (auto kernel = cached.lock()) return kernel;
+
+    const auto settings = getSettings(quality);
+    auto kernel = std::make_shared<Kernel>();
+    kernel->numTaps = settings.numTaps;
+    kernel->numPhases = settings.numPhases;
+    kernel->table.allocate((size_t) ((settings.numPhases + 1) * settings.numTaps), true);
+
+    const int half = settings.numTaps / 2;
+    const double windowScale = 1.0 / besselI0(settings.beta);
+
+    for (int phase = 0; phase <= settings.numPhases; ++phase) {
+        auto* row = kernel->table + phase * settings.numTaps;
+        const double fraction = (double) phase / settings.numPhases;
+        double sum = 0.0;
+
+        // Tap j lands on the input sample (half - 1 - j) before the output's position
+        for (int j = 0; j < settings.numTaps; ++j) {
+            const double x = fraction + half - 1 - j;
+            const double u = x / half;
+            const double window = std::abs(u) < 1.0 ? besselI0(settings.beta * std::sqrt(1.0 - u * u)) * windowScale : 0.0;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(juce::MathConstants<double>::pi * cutoff * x)
+                                                 / (juce::MathConstants<double>::pi * cutoff * x);
+            row[j] = (float) (cutoff * sinc * window);
+            sum += row[j];
+        }
+
+        // Unity gain at DC for every phase, so there's no ripple from the tabulation
+        if (sum != 0.0)
+            juce::FloatVectorOperations::multiply(row, (float) (1.0 / sum), settings.numTaps);
+    }
+
+    cached = kernel;
+    return kernel;
+}
+
+
+//===================================== SincResampler =========================================
+
+SincResampler::SincResampler(int channels) : numChannels(channels) {}
+
+SincResampler::~SincResampler() {}
+
+int SincResampler::getNumTaps(ResamplingQuality quality) noexcept {
+    return getSettings(quality).numTaps;
+}
+
+void SincResampler::prepare(ResamplingQuality quality, double inputPerOutput, int maxOutputSamples) {
+    jassert (inputPerOutput > 0.0);
+    ratio = inputPerOutput;
+
+    // Downsampling lowers the cutoff to the output's Nyquist frequency
+    kernel = getKernel(quality, juce::jmin(1.0, 1.0 / ratio) * getSettings(quality).rolloff);
+    numTaps = kernel->numTaps;
+
+    history.setSize(numChannels, 2 * numTaps + (int) std::ceil(maxOutputSamples * ratio) + 4);
+    coefficients.allocate((size_t) numTaps, true);
+    reset();
+}
+
+void SincResampler::reset(double firstOutputTime) {
+    // Whatever the filter reaches back to before the first input is silence
+    const int padding = juce::jmax(0, getLookBehind() - (int) std::floor(firstOutputTime));
+    history.clear(0, juce::jmin(padding, history.getNumSamples()));
+    numBuffered = padding;
+    time = firstOutputTime + padding;
+}
+
+int SincResampler::getNumInputSamplesNeeded(int numOutputSamples) const noexcept {
+    if (numOutputSamples <= 0) return 0;
+
+    // The same sum process() works out, so the two agree on where the last output falls
+    const double last = time + (numOutputSamples - 1) * ratio;
+    return juce::jmax(0, (int) last + numTaps / 2 + 1 - numBuffered);
+}
+
+void SincResampler::process(const float* const* input, int numInputSamples, float* const* output,
+                            int numOutputSamples) noexcept {
+    jassert (kernel != nullptr && numBuffered + numInputSamples <= history.getNumSamples());
+
+    for (int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::copy(history.getWritePointer(ch, numBuffered), input[ch], numInputSamples);
+    numBuffered += numInputSamples;
+
+    const int half = numTaps / 2;
+    const int numPhases = kernel->numPhases;
+
+    for (int i = 0; i < numOutputSamples; ++i) {
+        const double t = time + i * ratio;
+        const int index = (int) t;
+        const double phase = (t - index) * numPhases;
+        const int row = juce::jmin((int) phase, numPhases - 1);
+        const float fraction = (float) (phase - row);
+
+        // The filter for this output, interpolated between the two nearest tabulated phases
+        juce::FloatVectorOperations::copyWithMultiply(coefficients, kernel->getRow(row), 1.0f - fraction, numTaps);
+        juce::FloatVectorOperations::addWithMultiply(coefficients, kernel->getRow(row + 1), fraction, numTaps);
+
+        const int first = index - half + 1;
+        jassert (first >= 0 && first + numTaps <= numBuffered);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            output[ch][i] = dotProduct(history.getReadPointer(ch, first), coefficients, numTaps);
+    }
+
+    time += numOutputSamples * ratio;
+
+    // Drop the input the filter won't reach back to again
+    const int used = juce::jlimit(0, numBuffered, (int) time - getLookBehind());
+    if (used > 0) {
+        for (int ch = 0; ch < numChannels; ++ch) {
+            auto* samples = history.getWritePointer(ch);
+            std::memmove(samples, samples + used, (size_t) (numBuffered - used) * sizeof (float));
+        }
+        numBuffered -= used;
+        time -= used;
+    }
+}
+
+
+//===================================== SincResamplingSource =========================================
+
+SincResamplingSource::SincResamplingSource(juce::PositionableAudioSource* source, bool deleteInputWhenDeleted, int channels)
+    : input(source, deleteInputWhenDeleted), numChannels(channels), resampler(channels),
+      outputPointers((size_t) channels) {}
+
+SincResamplingSource::~SincResamplingSource() {}
+
+void SincResamplingSource::setInput(juce::PositionableAudioSource* newInput, double newInputRate) {
+    input.setNonOwned(newInput);
+    expectedInputPosition = -1;
+    setRates(newInputRate, outputRate);
+}
+
+void SincResamplingSource::setRates(double newInputRate, double fixedOutputRate) {
+    inputRate = newInputRate;
+    outputRate = fixedOutputRate;
+    ratio = (inputRate > 0.0 && outputRate > 0.0) ? inputRate / outputRate : 1.0;
+    if (blockSize > 0) prepareToPlay(blockSize, deviceRate);
+}
+
+void SincResamplingSource::setQuality(ResamplingQuality newQuality) {
+    quality = newQuality;
+    if (blockSize > 0) prepareToPlay(blockSize, deviceRate);
+}
+
+juce::int64 SincResamplingSource::seekInput(juce::int64 outputPosition) {
+    // The filter needs a little of what comes before the position, so reading starts that much earlier
+    const auto lookBehind = SincResampler::getNumTaps(quality) / 2 - 1;
+    const double inputPosition = outputPosition * ratio.load();
+    const auto start = juce::jmax((juce::int64) 0, (juce::int64) std::floor(inputPosition) - lookBehind);
+
+    input->setNextReadPosition(start);
+    expectedInputPosition = start;
+    return start;
+}
+
+//==============================================================================
+void SincResamplingSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    blockSize = samplesPerBlockExpected;
+    deviceRate = sampleRate;
+
+    const double out = outputRate > 0.0 ? outputRate : sampleRate;
+    const double newRatio = (inputRate > 0.0 && out > 0.0) ? inputRate / out : 1.0;
+    ratio = newRatio;
+    if (input == nullptr) return;
+
+    // Prepared just as an AudioTransportSource would prepare it, so mixes prepared ahead of time are ready as they are
+    inputBlockSize = juce::jmax(1, juce::roundToInt(samplesPerBlockExpected * newRatio));
+    input->prepareToPlay(inputBlockSize, sampleRate * newRatio);
+
+    if (newRatio != 1.0) {
+        resampler.prepare(quality, newRatio, samplesPerBlockExpected);
+        inputBuffer.setSize(numChannels, (int) std::ceil(samplesPerBlockExpected * newRatio)
+                                         + 2 * SincResampler::getNumTaps(quality) + 4);
+        discardBuffer.setSize(1, samplesPerBlockExpected);
+    }
+
+    // Carry on from where the input is, if something else has moved it
+    const auto inputPosition = input->getNextReadPosition();
+    if (inputPosition != expectedInputPosition.load())
+        position = (juce::int64) std::llround(inputPosition / newRatio);
+
+    setNextReadPosition(position.load());
+}
+
+void SincResamplingSource::releaseResources() {
+    blockSize = 0;
+    if (input != nullptr) input->releaseResources();
+}
+
+void SincResamplingSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    if (input == nullptr || blockSize == 0) {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    if (isBypassed()) {
+        input->getNextAudioBlock(bufferToFill);
+        return;
+    }
+
+    const double currentRatio = ratio.load();
+    // The input and the resampler move together, so neither is ever read from where the other isn't
+    const auto seekTo = pendingSeek.exchange(-1);
+    if (seekTo >= 0) {
+        const auto inputStart = seekInput(seekTo);
+        resampler.reset(seekTo * currentRatio - (double) inputStart);
+    }
+
+    auto start = position.load();
+    auto& buffer = *bufferToFill.buffer;
+
+    // Channels the resampler has that the output doesn't are thrown away, and any the output has spare are silent
+    for (int ch = 0; ch < numChannels; ++ch)
+        outputPointers[ch] = ch < buffer.getNumChannels() ? buffer.getWritePointer(ch, bufferToFill.startSample)
+                                                          : discardBuffer.getWritePointer(0);
+    for (int ch = numChannels; ch < buffer.getNumChannels(); ++ch)
+        buffer.clear(ch, bufferToFill.startSample, bufferToFill.numSamples);
+
+    for (int done = 0; done < bufferToFill.numSamples;) {
+        const int num = juce::jmin(blockSize, bufferToFill.numSamples - done);
+        const int needed = resampler.getNumInputSamplesNeeded(num);
+
+        // Read in blocks no bigger than the input was prepared for
+        for (int got = 0; got < needed;) {
+            const int chunk = juce::jmin(inputBlockSize, needed - got);
+            input->getNextAudioBlock(juce::AudioSourceChannelInfo(&inputBuffer, got, chunk));
+            got += chunk;
+        }
+        expectedInputPosition += needed;
+
+        resampler.process(inputBuffer.getArrayOfReadPointers(), needed, outputPointers, num);
+
+        done += num;
+        for (int ch = 0; ch < juce::jmin(numChannels, buffer.getNumChannels()); ++ch)
+            outputPointers[ch] += num;
+    }
+
+    // If another thread seeked while we were reading, its position wins
+    position.compare_exchange_strong(start, start + bufferToFill.numSamples);
+}
+
+void SincResamplingSource::setNextReadPosition(juce::int64 newPosition) {
+    position = newPosition;
+    if (input == nullptr) return;
+
+    if (isBypassed()) {
+        pendingSeek = -1;
+        input->setNextReadPosition(newPosition);
+        return;
+    }
+
+    // Both the input and the resampler start over from here on the audio thread, at the next block
+    pendingSeek = newPosition;
+}
+
+void SincResamplingSource::prefetchAt(juce::int64 newPosition) {
+    if (input == nullptr) return;
+
+    const auto lookBehind = SincResampler::getNumTaps(quality) / 2 - 1;
+    const auto inputPosition = (juce::int64) std::floor(newPosition * ratio.load()) - (isBypassed() ? 0 : lookBehind);
+    PrefetchableSource::prefetch(input.get(), juce::jmax((juce::int64) 0, inputPosition));
+}
+
+juce::int64 SincResamplingSource::getNextReadPosition() const {
+    if (input != nullptr && isBypassed()) return input->getNextReadPosition();
+    return position.load();
+}
+
+juce::int64 SincResamplingSource::getTotalLength() const {
+    if (input == nullptr) return 0;
+    return (juce::int64) std::ceil(input->getTotalLength() / ratio.load());
+}
+
+
+//===================================== Whole buffers =========================================
+
+juce::AudioBuffer<float> resampleBuffer(const juce::AudioBuffer<float>& source, double sourceRate, double targetRate,
+                                        std::function<bool()> shouldExit) {
+    const int numChannels = source.getNumChannels();
+    const double ratio = sourceRate / targetRate;
+    const int numOutput = (int) std::ceil(source.getNumSamples() / ratio);
+    const int chunk = 65536;
+
+    juce::AudioBuffer<float> result (numChannels, numOutput);
+    SincResampler resampler (numChannels);
+    resampler.prepare(ResamplingQuality::best, ratio, chunk);
+
+    juce::AudioBuffer<float> in (numChannels, (int) std::ceil(chunk * ratio) + 2 * SincResampler::getNumTaps(ResamplingQuality::best) + 4);
+    std::vector<float*> out ((size_t) numChannels);
+    int inputPosition = 0;
+
+    for (int done = 0; done < numOutput; done += chunk) {
+        if (shouldExit != nullptr && shouldExit()) return {};
+
+        const int num = juce::jmin(chunk, numOutput - done);
+        const int needed = resampler.getNumInputSamplesNeeded(num);
+
+        // Past the end of the source is silence
+        const int available = juce::jlimit(0, needed, source.getNumSamples() - inputPosition);
+        in.clear();
+        for (int ch = 0; ch < numChannels; ++ch) {
+            if (available > 0) in.copyFrom(ch, 0, source, ch, inputPosition, available);
+            out[(size_t) ch] = result.getWritePointer(ch, done);
+        }
+        inputPosition += needed;
+
+        resampler.process(in.getArrayOfReadPointers(), needed, out.data(), num);
+    }
+
+    return result;
+}
+
+
+//===================================== Benchmark =========================================
+
+juce::StringArray benchmarkResampling(double seconds) {
+    const double inputRate = 44100.0, outputRate = 48000.0, ratio = inputRate / outputRate;
+    const int numChannels = 2, blockSize = 512;
+    const int numBlocks = juce::jmax(1, (int) (seconds * outputRate / blockSize));
+    const double audioSeconds = numBlocks * blockSize / outputRate;
+
+    juce::AudioBuffer<float> noise (numChannels, 4 * blockSize);
+    juce::Random random;
+    for (int ch = 0; ch < numChannels; ++ch)
+        for (int i = 0; i < noise.getNumSamples(); ++i)
+            noise.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+
+    juce::AudioBuffer<float> output (numChannels, blockSize);
+    juce::StringArray results;
+
+    auto report = [&] (const juce::String& name, double startMs) {
+        const double cpuSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+        const double perChannel = cpuSeconds / audioSeconds / numChannels * 100.0;
+        results.add(name.paddedRight(' ', 24) + juce::String(perChannel, 4) + "% of a core per channel ("
+                    + juce::String(cpuSeconds / (numBlocks * (double) blockSize * numChannels) * 1.0e9, 1) + " ns a sample)");
+    };
+
+    // What an AudioTransportSource does when given a source sample rate
+    {
+        juce::MemoryAudioSource source (noise, false, true);
+        juce::ResamplingAudioSource resampling (&source, false, numChannels);
+        resampling.setResamplingRatio(ratio);
+        resampling.prepareToPlay(blockSize, outputRate);
+
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        for (int i = 0; i < numBlocks; ++i)
+            resampling.getNextAudioBlock(juce::AudioSourceChannelInfo(output));
+        report("Transport (linear)", start);
+    }
+
+    const std::pair<ResamplingQuality, const char*> qualities[] = {
+        { ResamplingQuality::draft, "Sinc draft (8 taps)" },
+        { ResamplingQuality::standard, "Sinc standard (24 taps)" },
+        { ResamplingQuality::best, "Sinc best (64 taps)" }
+    };
+
+    for (auto& quality : qualities) {
+        SincResampler resampler (numChannels);
+        resampler.prepare(quality.first, ratio, blockSize);
+
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        for (int i = 0; i < numBlocks; ++i)
+            resampler.process(noise.getArrayOfReadPointers(), resampler.getNumInputSamplesNeeded(blockSize),
+                              output.getArrayOfWritePointers(), blockSize);
+        report(quality.second, start);
+    }
+
+    return results;
+}
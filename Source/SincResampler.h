@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    SincResampler.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Windowed-sinc sample rate conversion for playback.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "RealtimeSync.h"
+
+
+/** How much CPU resampling may spend on sounding clean. Higher qualities use longer filters. */
+enum class ResamplingQuality {
+    draft,      // 8 taps
+    standard,   // 24 taps
+    best        // 64 taps
+};
+
+/** How playback resamples files whose sample rate differs from the device's. */
+struct ResamplingOptions {
+    ResamplingQuality quality = ResamplingQuality::standard;
+
+    /** Whether whole files are resampled to the device's rate in the background, into the DecodedAudioCache. */
+    bool preResample = false;
+
+    bool operator== (const ResamplingOptions& other) const noexcept {
+        return quality == other.quality && preResample == other.preResample;
+    }
+    bool operator!= (const ResamplingOptions& other) const noexcept { return ! operator== (other); }
+};
+
+
+/**
+ A polyphase windowed-sinc resampler for any number of channels, at any fixed ratio.
+
+ The filter is a Kaiser-windowed sinc, tabulated at a few hundred phases and interpolated between them, with
+ its cutoff lowered when downsampling so nothing aliases. Tables are shared between resamplers with the same
+ settings. Each output sample costs one pass over the filter per channel, done with SSE or NEON where
+ available.
+
+ Audio is pushed in and pulled out in one call: ask getNumInputSamplesNeeded() how much input the next block
+ of output takes, then hand exactly that much to process(). It doesn't allocate once prepared.
+ */
+class SincResampler {
+public:
+    explicit SincResampler(int numChannels);
+    ~SincResampler();
+
+    /**
+     Get ready to resample, building (or finding) the filter. Not for the audio thread.
+     @param quality             The filter to use.
+     @param inputPerOutput      Input samples per output sample, i.e. the input rate over the output rate.
+     @param maxOutputSamples    The most output any one call to process() will ask for.
+     */
+    void prepare(ResamplingQuality quality, double inputPerOutput, int maxOutputSamples);
+
+    /**
+     Forget the audio pushed in so far, for a seek.
+     @param firstOutputTime     Where the next output sample falls, in input samples from the first one pushed in
+                                after this. Anything the filter needs from before that is taken as silence.
+     */
+    void reset(double firstOutputTime = 0.0);
+
+    /** How many input samples before an output sample the filter reaches back to. */
+    int getLookBehind() const noexcept { return numTaps / 2 - 1; }
+
+    /** How many more input samples process() needs to produce this much output. */
+    int getNumInputSamplesNeeded(int numOutputSamples) const noexcept;
+
+    /**
+     Resample a block.
+     @param input       numInputSamples samples per channel, which must be what getNumInputSamplesNeeded() asked for.
+     @param output      Where numOutputSamples samples per channel go.
+     */
+    void process(const float* const* input, int numInputSamples, float* const* output, int numOutputSamples) noexcept;
+
+    static int getNumTaps(ResamplingQuality quality) noexcept;
+
+private:
+    struct Kernel;
+    static std::shared_ptr<const Kernel> getKernel(ResamplingQuality quality, double cutoff);
+
+    const int numChannels;
+    std::shared_ptr<const Kernel> kernel;
+    int numTaps = 0;
+    double ratio = 1.0;
+
+    juce::AudioBuffer<float> history; // input not yet used up, per channel
+    juce::HeapBlock<float> coefficients;
+    int numBuffered = 0;
+    double time = 0.0; // position of the next output sample in history
+
+    JUCE_DECLARE_NON_COPYABLE (SincResampler)
+};
+
+
+/**
+ A PositionableAudioSource that plays another at a different sample rate through a SincResampler. Positions
+ and lengths are in output samples, so it stands in for the source wherever a different rate is wanted.
+
+ By default the output rate is whatever the source is prepared to play at, as with the resampling an
+ AudioTransportSource does, though it can be fixed instead. When the rates match, the source is played as it
+ is.
+ */
+class SincResamplingSource : public juce::PositionableAudioSource, public PrefetchableSource {
+public:
+    /**
+     @param input               The source to play, or nullptr to set one later with setInput().
+     @param deleteInputWhenDeleted  Whether this owns the input.
+     @param numChannels         The most channels that get resampled.
+     */
+    SincResamplingSource(juce::PositionableAudioSource* input, bool deleteInputWhenDeleted, int numChannels = 2);
+    ~SincResamplingSource() override;
+
+    /**
+     Change what's played. Only while this isn't being played, since it isn't thread-safe.
+     @param newInput    The source to play, which this doesn't own.
+     @param inputRate   Its sample rate.
+     */
+    void setInput(juce::PositionableAudioSource* newInput, double inputRate);
+
+    /** Change the sample rates converted between. Only while this isn't being played. */
+    void setRates(double inputRate, double fixedOutputRate = 0.0);
+
+    /** Change the filter. Only while this isn't being played. */
+    void setQuality(ResamplingQuality newQuality);
+
+    /** Prefetches the input from the filter's first sample for a position, if the input can be prefetched. */
+    void prefetchAt(juce::int64 position) override;
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override { return false; }
+
+private:
+    juce::int64 seekInput(juce::int64 outputPosition);
+    bool isBypassed() const noexcept { return ratio.load() == 1.0; }
+
+    juce::OptionalScopedPointer<juce::PositionableAudioSource> input;
+    const int numChannels;
+    ResamplingQuality quality = ResamplingQuality::standard;
+    double inputRate = 0.0, outputRate = 0.0;
+
+    SincResampler resampler;
+    juce::AudioBuffer<float> inputBuffer, discardBuffer;
+    juce::HeapBlock<float*> outputPointers;
+    int blockSize = 0, inputBlockSize = 0;
+    double deviceRate = 0.0;
+    std::atomic<double> ratio { 1.0 };
+
+    std::atomic<juce::int64> position { 0 };
+    std::atomic<juce::int64> pendingSeek { -1 };            // an output position to restart the input and resampler from, or -1
+    std::atomic<juce::int64> expectedInputPosition { -1 };  // where reading and seeking have left the input
+
+    JUCE_DECLARE_NON_COPYABLE (SincResamplingSource)
+};
+
+
+/**
+ Resample a whole buffer at once, at the best quality, for audio resampled ahead of time.
+ @return    The resampled audio, or an empty buffer if shouldExit returned true part way through.
+ */
+juce::AudioBuffer<float> resampleBuffer(const juce::AudioBuffer<float>& source, double sourceRate, double targetRate,
+                                        std::function<bool()> shouldExit = nullptr);
+
+/**
+ Time each resampling quality, and the resampling an AudioTransportSource does, converting noise from
+ 44.1 kHz to 48 kHz.
+ @param seconds     How much audio each one converts.
+ @return    One line per resampler, with the CPU it takes per channel as a share of one core in real time.
+ */
+juce::StringArray benchmarkResampling(double seconds = 30.0);
@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+
+    StreamingAudioSource.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "StreamingAudioSource.h"
+
+
+//===================================== IndexJob =========================================
+
+/** Opens a file and builds its reader's seek index. */
+class SeekIndexCache::IndexJob : public juce::ThreadPoolJob {
+public:
+    IndexJob(SeekIndexCache& c, const juce::File& f, const juce::String& k)
+        : ThreadPoolJob("index " + f.getFileName()), cache(c), file(f), key(k) {}
+
+    JobStatus runJob() override {
+        std::unique_ptr<juce::AudioFormatReader> reader (cache.formatManager.createReaderFor(file));
+
+        if (reader != nullptr && reader->lengthInSamples > 0 && ! shouldExit()) {
+            // Reading the very end has the decoder find its way through the whole file
+            juce::AudioBuffer<float> end ((int) reader->numChannels, 16);
+            reader->read(&end, 0, end.getNumSamples(), juce::jmax((juce::int64) 0, reader->lengthInSamples - end.getNumSamples()),
+                         true, true);
+            cache.add(key, std::move(reader));
+        }
+
+        const juce::ScopedLock sl (cache.lock);
+        cache.pending.removeString(key);
+        return jobHasFinished;
+    }
+
+private:
+    SeekIndexCache& cache;
+    const juce::File file;
+    const juce::String key;
+
+    JUCE_DECLARE_NON_COPYABLE (IndexJob)
+};
+
+
+//===================================== SeekIndexCache =========================================
+
+SeekIndexCache::SeekIndexCache() {
+    formatManager.registerBasicFormats();
+}
+
+SeekIndexCache::~SeekIndexCache() {
+    pool.removeAllJobs(true, -1);
+}
+
+juce::String SeekIndexCache::getKey(const juce::File& file) {
+    return file.getFullPathName() + "|" + juce::String(file.getLastModificationTime().toMilliseconds());
+}
+
+std::unique_ptr<juce::AudioFormatReader> SeekIndexCache::open(const juce::File& file) {
+    const auto key = getKey(file);
+
+    {
+        const juce::ScopedLock sl (lock);
+        for (int i = 0; i < entries.size(); ++i) {
+            if (entries.getUnchecked(i)->key == key) {
+                std::unique_ptr<Entry> entry (entries.removeAndReturn(i));
+                return std::move(entry->reader);
+            }
+        }
+
+        // Either it's never been indexed or its indexed reader is in use, so one is built for next time
+        if (! pending.contains(key)) {
+            pending.add(key);
+            pool.addJob(new IndexJob(*this, file, key), true);
+        }
+    }
+
+    return std::unique_ptr<juce::AudioFormatReader> (formatManager.createReaderFor(file));
+}
+
+void SeekIndexCache::release(const juce::String& key, std::unique_ptr<juce::AudioFormatReader> reader) {
+    if (reader != nullptr) add(key, std::move(reader));
+}
+
+void SeekIndexCache::add(const juce::String& key, std::unique_ptr<juce::AudioFormatReader> reader) {
+    const juce::ScopedLock sl (lock);
+
+    // A file played twice at once hands back two readers; one is enough
+    for (auto* entry : entries)
+        if (entry->key == key) return;
+
+    entries.insert(0, new Entry { key, std::move(reader) });
+    while (entries.size() > maxReaders)
+        entries.removeLast();
+}
+
+
+//===================================== StreamingAudioSource =========================================
+
+std::unique_ptr<StreamingAudioSource> StreamingAudioSource::create(const juce::File& file, juce::AudioFormatManager& formatManager) {
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+    if (format == nullptr || ! format->isCompressed()) return nullptr;
+
+    juce::SharedResourcePointer<SeekIndexCache> seekIndex;
+    auto key = SeekIndexCache::getKey(file);
+    auto reader = seekIndex->open(file);
+    if (reader == nullptr || reader->lengthInSamples <= 0) return nullptr;
+
+    return std::unique_ptr<StreamingAudioSource> (new StreamingAudioSource(key, std::move(reader)));
+}
+
+StreamingAudioSource::StreamingAudioSource(const juce::String& k, std::unique_ptr<juce::AudioFormatReader> r)
+    : key(k), reader(std::move(r)) {
+    readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader.get(), false);
+
+    const int readAhead = (int) juce::jmax(131072.0, readAheadSeconds * reader->sampleRate);
+    buffered = std::make_unique<juce::BufferingAudioSource>(readerSource.get(), *decodeThread, false,
+                                                            readAhead, (int) reader->numChannels);
+}
+
+StreamingAudioSource::~StreamingAudioSource() {
+    // Decoding has stopped once the buffer's gone, so the reader's free to go back, index and all
+    buffered.reset();
+    readerSource.reset();
+    seekIndex->release(key, std::move(reader));
+}
+
+//==============================================================================
+void StreamingAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate) {
+    buffered->prepareToPlay(samplesPerBlockExpected, sampleRate);
+}
+
+void StreamingAudioSource::releaseResources() {
+    buffered->releaseResources();
+}
+
+void StreamingAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) {
+    buffered->getNextAudioBlock(bufferToFill);
+}
+
+void StreamingAudioSource::setNextReadPosition(juce::int64 newPosition) {
+    buffered->setNextReadPosition(newPosition);
+}
+
+juce::int64 StreamingAudioSource::getNextReadPosition() const {
+    return buffered->getNextReadPosition();
+}
+
+juce::int64 StreamingAudioSource::getTotalLength() const {
+    return buffered->getTotalLength();
+}
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    StreamingAudioSource.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Streaming playback of compressed audio files (FLAC, Ogg Vorbis, MP3).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+/**
+ The thread compressed files are decoded ahead of playback on. It's shared by everything that streams them,
+ through a juce::SharedResourcePointer, and kept apart from the thread that reads uncompressed files so a slow
+ decoder never holds those up.
+ */
+class DecodeThread : public juce::TimeSliceThread {
+public:
+    DecodeThread() : TimeSliceThread("compressed audio decode") { startThread(4); }
+    ~DecodeThread() override { stopThread(2000); }
+
+    JUCE_DECLARE_NON_COPYABLE (DecodeThread)
+};
+
+
+/**
+ Keeps compressed files' readers open once they've been indexed for seeking, keyed by path and modification
+ time. JUCE's decoders build their seek tables inside the reader as they go (the MP3 reader records where
+ each frame starts the first time it passes it) and lose them when the reader is deleted, so seeking far into
+ a freshly opened file means scanning everything before it.
+
+ The first time a file is opened, a second reader is indexed on a background thread by seeking to the end of
+ the file, and kept here. Later opens take that reader instead of a new one, and hand it back when playback
+ is done with it, so the index is built once per file. One cache is shared through a
+ juce::SharedResourcePointer. It is thread-safe.
+ */
+class SeekIndexCache {
+public:
+    SeekIndexCache();
+    ~SeekIndexCache();
+
+    /**
+     Open a file for streaming, with its seek index if one has been built. Otherwise a new reader is
+     returned, and the file is indexed in the background for next time.
+     @return    The reader, or nullptr if the file couldn't be read.
+     */
+    std::unique_ptr<juce::AudioFormatReader> open(const juce::File& file);
+
+    /**
+     Hand back a reader that open() gave out, so its index is kept.
+     @param key     The file's key, from getKey() when it was opened.
+     */
+    void release(const juce::String& key, std::unique_ptr<juce::AudioFormatReader> reader);
+
+    static juce::String getKey(const juce::File& file);
+
+    static constexpr int maxReaders = 16; // each holds a file open
+
+private:
+    struct Entry {
+        juce::String key;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+    };
+
+    class IndexJob;
+
+    void add(const juce::String& key, std::unique_ptr<juce::AudioFormatReader> reader);
+
+    juce::CriticalSection lock;
+    juce::OwnedArray<Entry> entries; // most recently used first
+    juce::StringArray pending;       // being indexed
+
+    juce::AudioFormatManager formatManager;
+    juce::ThreadPool pool { 1 };
+
+    JUCE_DECLARE_NON_COPYABLE (SeekIndexCache)
+};
+
+
+/**
+ A PositionableAudioSource that streams a compressed file, decoding it several seconds ahead of playback on
+ the shared DecodeThread, with the file's reader (and so its seek index) coming from the shared SeekIndexCache.
+ */
+class StreamingAudioSource : public juce::PositionableAudioSource {
+public:
+    /**
+     Open a file for streaming.
+     @param file            The file to play.
+     @param formatManager   Used to find the file's format.
+     @return    The source, or nullptr if the file isn't compressed, in which case it should be read the usual
+                way, or couldn't be read.
+     */
+    static std::unique_ptr<StreamingAudioSource> create(const juce::File& file, juce::AudioFormatManager& formatManager);
+    ~StreamingAudioSource() override;
+
+    /** The reader, for the file's sample rate, length and channel count. */
+    const juce::AudioFormatReader& getReader() const noexcept { return *reader; }
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override;
+    bool isLooping() const override { return false; }
+
+    static constexpr double readAheadSeconds = 4.0; // decoding can stall for a while on a busy disk
+
+private:
+    StreamingAudioSource(const juce::String& key, std::unique_ptr<juce::AudioFormatReader> reader);
+
+    juce::SharedResourcePointer<SeekIndexCache> seekIndex;
+    juce::SharedResourcePointer<DecodeThread> decodeThread;
+
+    const juce::String key;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+    std::unique_ptr<juce::BufferingAudioSource> buffered;
+
+    JUCE_DECLARE_NON_COPYABLE (StreamingAudioSource)
+};
@@ -0,0 +1,294 @@
+/*
+  ==============================================================================
+
+    TakeWriter.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "TakeWriter.h"
+
+
+//===================================== TakeWriter =========================================
+
+TakeWriter::TakeWriter(std::unique_ptr<juce::AudioFormatWriter> w, RecordingFormat f,
+                       juce::TimeSliceThread& backgroundThread, int fifoSizeSamples)
+    : writer(std::move(w)), thread(backgroundThread), format(f),
+      primary((int) writer->getNumChannels(), fifoSizeSamples) {
+    initialise(fifoSizeSamples);
+}
+
+TakeWriter::TakeWriter(SegmentFactory opener, int numChannels, RecordingFormat f,
+                       juce::TimeSliceThread& backgroundThread, int fifoSizeSamples)
+    : openWriter(std::move(opener)), thread(backgroundThread), format(f),
+      primary(numChannels, fifoSizeSamples) {
+    initialise(fifoSizeSamples);
+}
+
+void TakeWriter::initialise(int fifoSizeSamples) {
+    const int numChannels = getNumChannels();
+    channelPointers.malloc(numChannels);
+    sourcePointers.malloc(numChannels);
+
+    spillStorage = std::make_unique<SampleFifo>(numChannels, fifoSizeSamples * spillRatio);
+    spill = spillStorage.get();
+
+    if (format != RecordingFormat::float32) {
+        intData.malloc((size_t) numChannels * (size_t) fifoSizeSamples);
+        for (int ch = 0; ch < numChannels; ++ch)
+            converters.add(new DitheredIntConverter(getBitsPerSample(format), fifoSizeSamples));
+    }
+
+    thread.addTimeSliceClient(this);
+}
+
+TakeWriter::~TakeWriter() {
+    thread.removeTimeSliceClient(this);
+
+    // Audio that was captured before the take is dropped rather than waited for
+    if (! writePrelude()) {
+        const juce::ScopedLock sl (setupLock);
+        prelude = nullptr;
+    }
+
+    while (writePendingData() > 0) {}
+}
+
+void TakeWriter::setSplitInterval(juce::int64 numSamples, SegmentFactory factory) {
+    const juce::ScopedLock sl (setupLock);
+    splitInterval = numSamples;
+    segmentFactory = std::move(factory);
+}
+
+void TakeWriter::setMarkedSplits(SegmentFactory factory) {
+    const juce::ScopedLock sl (setupLock);
+    markedSplitFactory = std::move(factory);
+}
+
+bool TakeWriter::markSplit(juce::int64 position, juce::int64 value) noexcept {
+    int start1, size1, start2, size2;
+    splitFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 == 0) return false;
+
+    splitQueue[size1 > 0 ? start1 : start2] = { position, value };
+    splitFifo.finishedWrite(1);
+    return true;
+}
+
+void TakeWriter::setPrelude(Prelude newPrelude) {
+    const juce::ScopedLock sl (setupLock);
+    prelude = std::move(newPrelude);
+}
+
+bool TakeWriter::SampleFifo::push(const float* const* data, int numSamples) noexcept {
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    if (size1 + size2 < numSamples) return false;
+
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch) {
+        buffer.copyFrom(ch, start1, data[ch], size1);
+        if (size2 > 0) buffer.copyFrom(ch, start2, data[ch] + size1, size2);
+    }
+
+    fifo.finishedWrite(size1 + size2);
+    return true;
+}
+
+bool TakeWriter::write(const float* const* data, int numSamples) noexcept {
+    if (numSamples <= 0) return true;
+
+    auto* spillFifo = spill.load();
+
+    // Once the writer thread has caught up on the spill FIFO, everything before it is on disk too
+    if (writingToSpill && spillFifo->fifo.getNumReady() == 0)
+        writingToSpill = false;
+
+    if (! writingToSpill) {
+        if (primary.push(data, numSamples)) {
+            const int used = primary.fifo.getNumReady();
+            if (used > highWaterMark.load(std::memory_order_relaxed))
+                highWaterMark.store(used, std::memory_order_relaxed);
+            samplesAccepted += numSamples;
+            return true;
+        }
+
+        writingToSpill = spillFifo != nullptr;
+    }
+
+    if (writingToSpill && spillFifo->push(data, numSamples)) {
+        spilledSamples.fetch_add(numSamples, std::memory_order_relaxed);
+        samplesAccepted += numSamples;
+        return true;
+    }
+
+    droppedSamples.fetch_add(numSamples, std::memory_order_relaxed);
+    return false;
+}
+
+TakeWriter::Stats TakeWriter::getStats() const noexcept {
+    Stats stats;
+    stats.droppedSamples = droppedSamples.load();
+    stats.spilledSamples = spilledSamples.load();
+    stats.fifoSize = primary.fifo.getTotalSize();
+    stats.highWaterMark = highWaterMark.load();
+    return stats;
+}
+
+int TakeWriter::getFifoSizeFor(double sampleRate, int totalChannels, double latencyBudget) {
+    // Across every channel of a take, the primary and spill FIFOs together use at most this much memory
+    const double maxBytes = 192.0 * 1024.0 * 1024.0;
+    const double maxSamples = maxBytes / ((double) sizeof(float) * (1 + spillRatio) * juce::jmax(1, totalChannels));
+
+    return (int) juce::jlimit(8192.0, maxSamples, sampleRate * latencyBudget);
+}
+
+int TakeWriter::useTimeSlice() {
+    return writePendingData() == 0 ? 10 : 0;
+}
+
+bool TakeWriter::writePrelude() {
+    const juce::ScopedLock sl (setupLock);
+    if (prelude == nullptr) return true;
+
+    juce::AudioBuffer<float> audio;
+    if (! prelude(audio)) return false;
+    prelude = nullptr;
+
+    jassert (audio.getNumChannels() == getNumChannels() || audio.getNumSamples() == 0);
+    writeSamples(audio.getArrayOfReadPointers(), audio.getNumSamples(), false);
+    return true;
+}
+
+int TakeWriter::writePendingData() {
+    // Nothing from the FIFO may be written until whatever precedes it is on disk
+    if (! writePrelude()) return 0;
+
+    int numWritten = drain(primary, primary.fifo.getNumReady());
+
+    // Spilled samples came after everything in the primary FIFO, so they can only be written once the
+    // primary is seen to be empty after counting them
+    if (auto* spillFifo = spill.load()) {
+        const int numSpilled = spillFifo->fifo.getNumReady();
+        if (numSpilled > 0 && primary.fifo.getNumReady() == 0)
+            numWritten += drain(*spillFifo, numSpilled);
+    }
+
+    return numWritten;
+}
+
+int TakeWriter::drain(SampleFifo& source, int numToDo) {
+    if (numToDo <= 0) return 0;
+
+    int start1, size1, start2, size2;
+    source.fifo.prepareToRead(numToDo, start1, size1, start2, size2);
+
+    auto writeRegion = [this, &source] (int start, int size) {
+        for (int ch = 0; ch < getNumChannels(); ++ch)
+            sourcePointers[ch] = source.buffer.getReadPointer(ch, start);
+        writeSamples(sourcePointers, size, true);
+    };
+
+    if (size1 > 0) writeRegion(start1, size1);
+    if (size2 > 0) writeRegion(start2, size2);
+
+    source.fifo.finishedRead(size1 + size2);
+    return size1 + size2;
+}
+
+void TakeWriter::splitIfMarked() {
+    for (;;) {
+        int start1, size1, start2, size2;
+        splitFifo.prepareToRead(1, start1, size1, start2, size2);
+        if (size1 == 0) return;
+
+        const auto split = splitQueue[start1];
+        if (split.position > samplesFromFifo) return;
+        splitFifo.finishedRead(1);
+
+        // One that's been passed already (which would mean the audio thread marked it late) is too late to honour
+        if (split.position < samplesFromFifo || samplesFromFifo == 0 || markedSplitFactory == nullptr) continue;
+
+        if (auto next = markedSplitFactory(split.value)) {
+            jassert (writer == nullptr || next->getNumChannels() == writer->getNumChannels());
+            writer = std::move(next); // closes the finished file
+            samplesSinceCommit = 0;
+            samplesInSegment = 0;
+        }
+    }
+}
+
+void TakeWriter::writeSamples(const float* const* data, int numSamples, bool fromFifo) {
+    if (numSamples <= 0) return;
+    
+    if (writer == nullptr) {
+        if (openWriter != nullptr) {
+            writer = openWriter(0);
+            openWriter = nullptr;
+            jassert (writer == nullptr || (int) writer->getNumChannels() == getNumChannels());
+        }
+        
+        if (writer == nullptr) {
+            droppedSamples.fetch_add(numSamples);
+            if (fromFifo) samplesFromFifo += numSamples;
+            return;
+        }
+    }
+    
+    const int numChannels = getNumChannels();
+    const int maxBlock = primary.fifo.getTotalSize();
+
+    for (int done = 0, num = 0; done < numSamples; done += num) {
+        if (fromFifo) splitIfMarked();
+        num = juce::jmin(maxBlock, numSamples - done);
+
+        // Never let a block straddle a split point
+        if (splitInterval > 0)
+            num = (int) juce::jmin((juce::int64) num, splitInterval - samplesInSegment);
+
+        if (fromFifo) {
+            int start1, size1, start2, size2;
+            splitFifo.prepareToRead(1, start1, size1, start2, size2);
+            if (size1 > 0)
+                num = (int) juce::jmin((juce::int64) num, splitQueue[start1].position - samplesFromFifo);
+        }
+
+        if (format == RecordingFormat::float32) {
+            // Float writers take IEEE floats through the int pointer interface, so no conversion is needed
+            for (int ch = 0; ch < numChannels; ++ch)
+                channelPointers[ch] = reinterpret_cast<const int*>(data[ch] + done);
+        } else {
+            for (int ch = 0; ch < numChannels; ++ch) {
+                int* dest = intData + ch * maxBlock;
+                converters.getUnchecked(ch)->convert(dest, data[ch] + done, num);
+                channelPointers[ch] = dest;
+            }
+        }
+
+        writer->write(channelPointers, num);
+        samplesSinceCommit += num;
+        samplesInSegment += num;
+        samplesInTake += num;
+        if (fromFifo) samplesFromFifo += num;
+
+        if (splitInterval > 0 && samplesInSegment >= splitInterval) {
+            if (auto next = segmentFactory(samplesInTake)) {
+                jassert (next->getNumChannels() == writer->getNumChannels());
+                writer = std::move(next); // closes the finished file
+                samplesSinceCommit = 0;
+            } else {
+                splitInterval = 0;
+            }
+            samplesInSegment = 0;
+        }
+    }
+
+    // The WAV writer's flush() rewrites the RIFF and data chunk sizes for everything written so far
+    const int interval = headerCommitInterval.load();
+    if (interval > 0 && samplesSinceCommit >= interval) {
+        writer->flush();
+        samplesSinceCommit = 0;
+    }
+}
@@ -0,0 +1,215 @@
+/*
+  ==============================================================================
+
+    TakeWriter.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    Spark's replacement for juce::AudioFormatWriter::ThreadedWriter.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleConversion.h"
+
+
+/**
+ Buffers audio from the real-time thread in a lock-free FIFO and writes it to disk on a TimeSliceThread.
+
+ Unlike ThreadedWriter, the sample conversion happens here rather than inside the format writer: integer
+ formats go through a vectorised DitheredIntConverter, and float formats are handed to the writer as-is.
+
+ It also never drops audio silently. Alongside the FIFO it allocates a larger spill FIFO up front, which the
+ audio thread overflows into if the disk falls behind; only when both are full are samples dropped. Dropped and spilled sample counts and the FIFO high-water mark are available from getStats().
+ */
+class TakeWriter : public juce::TimeSliceClient {
+public:
+    /**
+     Creates a TakeWriter and registers it with a thread.
+     @param writer              The format writer to send audio to. Must have been created with the bit depth of format.
+     @param format              The sample format the writer expects.
+     @param backgroundThread    The thread on which data is written to disk.
+     @param fifoSizeSamples     Number of samples per channel the FIFO can hold.
+     */
+    TakeWriter(std::unique_ptr<juce::AudioFormatWriter> writer, RecordingFormat format,
+               juce::TimeSliceThread& backgroundThread, int fifoSizeSamples);
+    
+    /**
+     Creates the writer for a file, on the writer thread.
+     @param samplesWrittenSoFar     How far into the take the file starts.
+     @return    The new writer, which must have the same channel count and sample format as the take; or nullptr
+                if it couldn't be created.
+     */
+    using SegmentFactory = std::function<std::unique_ptr<juce::AudioFormatWriter> (juce::int64 samplesWrittenSoFar)>;
+    
+    /**
+     Creates a TakeWriter that doesn't open its file until the first audio (including any prelude) reaches the
+     writer thread, for takes whose header depends on exactly when they start. If the file can't be opened
+     then, the take's audio is counted as dropped.
+     @param openWriter          Called once, with 0, to create the writer.
+     @param numChannels         Number of channels the writer will have.
+     @param format              The sample format the writer will expect.
+     @param backgroundThread    The thread on which data is written to disk.
+     @param fifoSizeSamples     Number of samples per channel the FIFO can hold.
+     */
+    TakeWriter(SegmentFactory openWriter, int numChannels, RecordingFormat format,
+               juce::TimeSliceThread& backgroundThread, int fifoSizeSamples);
+
+    /**
+     Writes any remaining buffered audio and closes the file. Blocks until done.
+     */
+    ~TakeWriter() override;
+
+    /**
+     A function run on the writer thread before any FIFO data is written, used to put audio that was captured
+     before the take started (such as pre-roll) at the beginning of the file. It fills the buffer it's given
+     with the audio to write first, and returns false if that audio isn't available yet, in which case it
+     is called again on the next time slice. If it still isn't ready when the TakeWriter is deleted, it is dropped.
+     */
+    using Prelude = std::function<bool (juce::AudioBuffer<float>&)>;
+
+    /**
+     Set the prelude for this take. Must be called before the first call to write().
+     */
+    void setPrelude(Prelude newPrelude);
+
+    /**
+     Make the writer rewrite its file header every so often, so the sizes on disk are never more than this
+     far behind the audio. After a crash, everything up to the last commit is readable and the rest can be
+     recovered with ProjectManagement::repairTruncatedWav(). 0 (the default) only writes the header on close.
+     @param numSamples  Interval between header commits, in samples.
+     */
+    void setHeaderCommitInterval(int numSamples) { headerCommitInterval = numSamples; }
+
+    /**
+     Split the take into sequential files of at most numSamples samples each. The split happens on an exact
+     sample boundary, and each file is closed (with a final header) as soon as the next one is open. If the
+     factory returns nullptr, splitting stops and the take carries on in the current file.
+     Must be called before the first call to write().
+     */
+    void setSplitInterval(juce::int64 numSamples, SegmentFactory factory);
+
+    /**
+     Let the audio thread split the take into sequential files at samples of its choosing, with markSplit(),
+     for takes whose files don't simply follow on from each other (such as one per pass of a loop). Each
+     file is closed as soon as the next one is open. Must be called before the first call to write().
+     @param factory     Creates each new file's writer on the writer thread. It's given the value the split was
+                        marked with, rather than how far into the take it is.
+     */
+    void setMarkedSplits(SegmentFactory factory);
+
+    /**
+     Start a new file on an exact sample. Real-time safe. Splits must be marked in order, and may be ahead of
+     what has been written so far; any the take never reaches are ignored.
+     @param position    The first sample of the new file, counting the samples write() has accepted (so not
+                        the prelude). Must be after the first.
+     @param value       Passed to the factory.
+     @return False if too many splits were already waiting, in which case this one is ignored.
+     */
+    bool markSplit(juce::int64 position, juce::int64 value) noexcept;
+
+    /**
+     Pushes a block of audio into the FIFO. Real-time safe.
+     @return False if the FIFO was too full to take the whole block, in which case none of it was written.
+     */
+    bool write(const float* const* data, int numSamples) noexcept;
+
+    /** How many samples write() has accepted so far, the count markSplit() positions are in. Audio thread only. */
+    juce::int64 getNumSamplesAccepted() const noexcept { return samplesAccepted; }
+
+    int getNumChannels() const noexcept { return primary.buffer.getNumChannels(); }
+
+    /** Counters describing how well the disk has kept up with this take. */
+    struct Stats {
+        juce::int64 droppedSamples = 0; // samples lost because both FIFOs were full, or the file couldn't be opened
+        juce::int64 spilledSamples = 0; // samples that went through the spill FIFO
+        int fifoSize = 0;               // capacity of the primary FIFO, in samples per channel
+        int highWaterMark = 0;          // most samples ever waiting in the primary FIFO
+    };
+
+    /**
+     Get this take's counters. Safe to call from any thread.
+     */
+    Stats getStats() const noexcept;
+
+    /**
+     Pick a FIFO size, in samples per channel, that rides out a disk stall of latencyBudget seconds while
+     keeping the whole take's buffering, spill FIFOs included, under a fixed memory cap.
+     @param sampleRate          The device sample rate.
+     @param totalChannels       Channels being recorded across every file in the take.
+     @param latencyBudget       Longest disk stall to absorb without spilling, in seconds.
+     */
+    static int getFifoSizeFor(double sampleRate, int totalChannels, double latencyBudget);
+    
+    static constexpr int spillRatio = 2; // how many times larger than the primary FIFO the spill FIFO is
+
+    int useTimeSlice() override;
+
+private:
+    void initialise(int fifoSizeSamples);
+    
+    /** A lock-free single-producer/single-consumer FIFO of multichannel audio. */
+    struct SampleFifo {
+        SampleFifo(int numChannels, int size) : fifo(size), buffer(numChannels, size) {}
+        bool push(const float* const* data, int numSamples) noexcept;
+
+        juce::AbstractFifo fifo;
+        juce::AudioBuffer<float> buffer;
+    };
+
+    /** Writes everything currently in the FIFOs. @return The number of samples written. */
+    int writePendingData();
+    int drain(SampleFifo&, int numSamples);
+    bool writePrelude();
+    void writeSamples(const float* const* data, int numSamples, bool fromFifo);
+    void splitIfMarked();
+
+    std::unique_ptr<juce::AudioFormatWriter> writer;
+    SegmentFactory openWriter; // for deferred opening; cleared once used
+    juce::TimeSliceThread& thread;
+    const RecordingFormat format;
+
+    SampleFifo primary;
+
+    // Allocated with the take rather than when it's needed, since by then the writer thread is stuck on the
+    // slow disk. Once the audio thread overflows into it, it keeps writing there until the writer thread has
+    // emptied it, which keeps the samples in order.
+    std::unique_ptr<SampleFifo> spillStorage;
+    std::atomic<SampleFifo*> spill { nullptr };
+    bool writingToSpill = false; // only touched by the audio thread
+    juce::int64 samplesAccepted = 0; // likewise
+
+    std::atomic<int> headerCommitInterval { 0 };
+    int samplesSinceCommit = 0; // only touched by the writer thread
+
+    juce::int64 splitInterval = 0;
+    SegmentFactory segmentFactory;
+    juce::int64 samplesInSegment = 0, samplesInTake = 0; // only touched by the writer thread
+
+    /** A split marked by the audio thread. */
+    struct Split {
+        juce::int64 position, value;
+    };
+
+    SegmentFactory markedSplitFactory;
+    juce::AbstractFifo splitFifo { 64 };
+    juce::HeapBlock<Split> splitQueue { 64 };
+    juce::int64 samplesFromFifo = 0; // only touched by the writer thread
+
+    std::atomic<juce::int64> droppedSamples { 0 }, spilledSamples { 0 };
+    std::atomic<int> highWaterMark { 0 };
+
+    juce::CriticalSection setupLock; // only ever contended by the message and writer threads
+    Prelude prelude;
+
+    // Writer-thread scratch space for converted integer samples
+    juce::OwnedArray<DitheredIntConverter> converters;
+    juce::HeapBlock<int> intData;
+    juce::HeapBlock<const int*> channelPointers;
+    juce::HeapBlock<const float*> sourcePointers;
+
+    JUCE_DECLARE_NON_COPYABLE (TakeWriter)
+};
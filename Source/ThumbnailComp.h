@@ -14,6 +14,9 @@
 
 #include <JuceHeader.h>
 #include "DemoUtilities.h"
+#include "PlaybackTransport.h"
+#include "PeakCache.h"
+#include "WaveformPyramid.h"
 
 
 class ThumbnailComp : public juce::Component,
@@ -25,11 +28,11 @@ class ThumbnailComp : public juce::Component,
 {
 public:
     ThumbnailComp(juce::AudioFormatManager& formatManager,
-        juce::AudioTransportSource& source,
+        PlaybackTransport& source,
         juce::Slider& slider)
         : transportSource(source),
         zoomSlider(slider),
-        thumbnail(512, formatManager, thumbnailCache)
+        thumbnail(formatManager, *thumbnailCache)
     {
         thumbnail.addChangeListener(this);
 
@@ -55,7 +58,7 @@ public:
 #if ! JUCE_IOS
         if (url.isLocalFile())
         {
-            inputSource = new FileInputSource(url.getLocalFile());
+            inputSource = new PeakCache::FileSource(url.getLocalFile());
         }
         else
 #endif
@@ -66,14 +69,26 @@ public:
 
         if (inputSource != nullptr)
         {
+            message.clear();
             thumbnail.setSource(inputSource);
+            showWholeFile();
+        }
+    }
 
-            juce::Range<double> newRange(0.0, thumbnail.getTotalLength());
-            scrollbar.setRangeLimits(newRange);
-            setRange(newRange);
+    // Takes ownership of a reader that has already been opened, e.g. on a background thread
+    void setReader(juce::AudioFormatReader* reader, juce::int64 hashCode)
+    {
+        message.clear();
+        thumbnail.setReader(reader, hashCode);
+        showWholeFile();
+    }
 
-            startTimerHz(40);
-        }
+    // Shows some text in place of the waveform, e.g. while a file is loading
+    void setMessage(const juce::String& newMessage)
+    {
+        thumbnail.clear();
+        message = newMessage;
+        repaint();
     }
 
     juce::URL getLastDroppedFile() const noexcept { return lastFileDropped; }
@@ -97,6 +112,13 @@ public:
         repaint();
     }
 
+    // Shades the region being looped, in seconds; an empty range shows none
+    void setLoopRegion(Range<double> newRegion)
+    {
+        loopRegion = newRegion;
+        repaint();
+    }
+
     void setFollowsTransport(bool shouldFollow)
     {
         isFollowingTransport = shouldFollow;
@@ -114,11 +136,23 @@ public:
             thumbArea.removeFromBottom(scrollbar.getHeight() + 4);
             thumbnail.drawChannels(g, thumbArea.reduced(2),
                 visibleRange.getStart(), visibleRange.getEnd(), 1.0f);
+
+            if (!loopRegion.isEmpty())
+            {
+                auto x1 = timeToX(loopRegion.getStart());
+                auto x2 = timeToX(loopRegion.getEnd());
+                g.setColour(Colours::orange.withAlpha(0.2f));
+                g.fillRect(Rectangle<float>(x1, 0.0f, x2 - x1, (float)thumbArea.getBottom()));
+                g.setColour(Colours::orange);
+                g.drawVerticalLine(roundToInt(x1), 0.0f, (float)thumbArea.getBottom());
+                g.drawVerticalLine(roundToInt(x2), 0.0f, (float)thumbArea.getBottom());
+            }
         }
         else
         {
             g.setFont(14.0f);
-            g.drawFittedText("(No audio file selected)", getLocalBounds(), Justification::centred, 2);
+            g.drawFittedText(message.isNotEmpty() ? message : "(No audio file selected)",
+                getLocalBounds(), Justification::centred, 2);
         }
     }
 
@@ -179,15 +213,17 @@ public:
 
 
 private:
-    AudioTransportSource& transportSource;
+    PlaybackTransport& transportSource;
     Slider& zoomSlider;
     ScrollBar scrollbar{ false };
 
-    AudioThumbnailCache thumbnailCache{ 5 };
-    AudioThumbnail thumbnail;
+    SharedResourcePointer<PeakCache> thumbnailCache; // shared with every other thumbnail, and kept on disk
+    WaveformPyramid thumbnail; // drawn at whichever resolution suits the zoom
     Range<double> visibleRange;
+    Range<double> loopRegion;
     bool isFollowingTransport = false;
     URL lastFileDropped;
+    juce::String message;
 
     DrawableRectangle currentPositionMarker;
 
@@ -204,6 +240,15 @@ private:
         return (x / (float)getWidth()) * (visibleRange.getLength()) + visibleRange.getStart();
     }
 
+    void showWholeFile()
+    {
+        juce::Range<double> newRange(0.0, thumbnail.getTotalLength());
+        scrollbar.setRangeLimits(newRange);
+        setRange(newRange);
+
+        startTimerHz(40);
+    }
+
     bool canMoveTransport() const noexcept
     {
         return !(isFollowingTransport && transportSource.isPlaying());
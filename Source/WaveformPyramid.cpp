@@ -0,0 +1,471 @@
+/*
+  ==============================================================================
+
+    WaveformPyramid.cpp
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+  ==============================================================================
+*/
+
+#include "WaveformPyramid.h"
+
+
+namespace {
+    const int magic = (int) juce::ByteOrder::littleEndianInt("SPKW");
+}
+
+
+//===================================== WaveformPyramid =========================================
+
+void WaveformPyramid::Accumulator::add(float lo, float hi, double squares, int num) noexcept {
+    min = numSamples > 0 ? juce::jmin(min, lo) : lo;
+    max = numSamples > 0 ? juce::jmax(max, hi) : hi;
+    sumOfSquares += squares;
+    numSamples += num;
+}
+
+WaveformPyramid::WaveformPyramid(juce::AudioFormatManager& fm, juce::AudioThumbnailCache& c)
+    : formatManager(fm), cache(c) {
+    static_assert (sizeof (Point) == 3, "points are written to disk as they are");
+}
+
+WaveformPyramid::~WaveformPyramid() {
+    cache.getTimeSliceThread().removeTimeSliceClient(this);
+}
+
+void WaveformPyramid::clear() {
+    cache.getTimeSliceThread().removeTimeSliceClient(this);
+
+    {
+        const juce::ScopedLock rl (readerLock);
+        reader = nullptr;
+        source = nullptr;
+    }
+
+    {
+        const juce::ScopedLock rl (rawLock);
+        rawRange = {};
+        requestedRaw = {};
+    }
+
+    {
+        const juce::ScopedLock sl (lock);
+        levels.clear();
+        accumulators.clear();
+        numChannels = 0;
+        sampleRate = 0.0;
+        totalSamples = 0;
+        numSamplesFinished = 0;
+        lengthKnown = false;
+    }
+
+    hashCode = 0;
+    sendChangeMessage();
+}
+
+bool WaveformPyramid::setSource(juce::InputSource* newSource) {
+    clear();
+    if (newSource == nullptr) return false;
+
+    source.reset(newSource);
+    hashCode = newSource->hashCode();
+
+    // Even if it was cached, the file is opened in the background, for reading samples from at the deepest zoom
+    cache.loadThumb(*this, hashCode);
+    cache.getTimeSliceThread().addTimeSliceClient(this);
+    return true;
+}
+
+void WaveformPyramid::setReader(juce::AudioFormatReader* newReader, juce::int64 newHashCode) {
+    clear();
+    if (newReader == nullptr) return;
+
+    reader.reset(newReader);
+    hashCode = newHashCode;
+
+    cache.loadThumb(*this, hashCode);
+    cache.getTimeSliceThread().addTimeSliceClient(this);
+}
+
+int WaveformPyramid::useTimeSlice() {
+    const juce::ScopedLock rl (readerLock);
+
+    if (reader == nullptr) {
+        if (source != nullptr)
+            reader.reset(formatManager.createReaderFor(std::unique_ptr<juce::InputStream>(source->createInputStream())));
+        if (reader == nullptr || reader->lengthInSamples <= 0) return -1;
+    }
+
+    // Samples waiting to be drawn come before building any more of the levels
+    readRequestedRaw();
+
+    if (isFullyLoaded()) {
+        const juce::ScopedLock rl (rawLock);
+        return requestedRaw.isEmpty() ? -1 : 0;
+    }
+    if (numChannels.load() == 0) reset((int) reader->numChannels, reader->sampleRate, reader->lengthInSamples);
+
+    const auto start = numSamplesFinished.load();
+    const int num = (int) juce::jmin((juce::int64) chunkSize, reader->lengthInSamples - start);
+    readBuffer.setSize((int) reader->numChannels, num, false, false, true);
+    reader->read(&readBuffer, 0, num, start, true, true);
+    addBlock(start, readBuffer, 0, num);
+
+    if (! isFullyLoaded()) return 0;
+
+    cache.storeThumb(*this, hashCode);
+    return 0; // once more, to read any samples asked for meanwhile before leaving the thread
+}
+
+void WaveformPyramid::readRequestedRaw() {
+    juce::Range<juce::int64> range;
+    {
+        const juce::ScopedLock rl (rawLock);
+        range = requestedRaw.getIntersectionWith({ 0, reader->lengthInSamples });
+    }
+    if (range.isEmpty()) return;
+
+    readBuffer.setSize((int) reader->numChannels, (int) range.getLength(), false, false, true);
+    reader->read(&readBuffer, 0, (int) range.getLength(), range.getStart(), true, true);
+
+    {
+        const juce::ScopedLock rl (rawLock);
+        std::swap(rawBuffer, readBuffer);
+        rawRange = range;
+
+        // paint() may have moved on while this was read, in which case the newer request is left for next time
+        if (requestedRaw.getIntersectionWith({ 0, reader->lengthInSamples }) == range)
+            requestedRaw = {};
+    }
+
+    sendChangeMessage();
+}
+
+void WaveformPyramid::reset(int newNumChannels, double newSampleRate, juce::int64 totalSamplesInSource) {
+    const juce::ScopedLock sl (lock);
+
+    levels.clearQuick();
+    levels.resize(numLevels * newNumChannels);
+    accumulators.clearQuick();
+    accumulators.resize(numLevels * newNumChannels);
+
+    numChannels = newNumChannels;
+    sampleRate = newSampleRate;
+    totalSamples = juce::jmax((juce::int64) 0, totalSamplesInSource);
+    numSamplesFinished = 0;
+    lengthKnown = totalSamplesInSource > 0;
+}
+
+void WaveformPyramid::addBlock(juce::int64 sampleNumberInSource, const juce::AudioBuffer<float>& newData,
+                               int startOffsetInBuffer, int numSamples) {
+    if (numSamples <= 0 || sampleNumberInSource != numSamplesFinished.load()) return;
+
+    {
+        const juce::ScopedLock sl (lock);
+        const int nch = numChannels.load();
+
+        for (int ch = 0; ch < juce::jmin(nch, newData.getNumChannels()); ++ch) {
+            const float* samples = newData.getReadPointer(ch, startOffsetInBuffer);
+
+            // A point at a time, so each run of samples is scanned once
+            for (int done = 0; done < numSamples;) {
+                auto& acc = accumulators.getReference(ch);
+                const int num = juce::jmin(numSamples - done, finestSamplesPerPoint - acc.numSamples);
+                const auto range = juce::FloatVectorOperations::findMinAndMax(samples + done, num);
+
+                double squares = 0.0;
+                for (int i = 0; i < num; ++i)
+                    squares += (double) samples[done + i] * samples[done + i];
+
+                acc.add(range.getStart(), range.getEnd(), squares, num);
+                if (acc.numSamples == finestSamplesPerPoint) finishPoint(0, ch);
+                done += num;
+            }
+        }
+
+        numSamplesFinished = sampleNumberInSource + numSamples;
+
+        // Fed live, the audio so far is all there is until it's finished; otherwise the last points are
+        // finished once the whole source is in
+        if (! lengthKnown.load())
+            totalSamples = numSamplesFinished.load();
+        else if (numSamplesFinished.load() >= totalSamples.load())
+            finishPartialPoints();
+    }
+
+    sendChangeMessage();
+}
+
+void WaveformPyramid::finishLiveInput() {
+    {
+        const juce::ScopedLock sl (lock);
+        if (lengthKnown.load()) return;
+
+        totalSamples = numSamplesFinished.load();
+        lengthKnown = true;
+        finishPartialPoints();
+    }
+
+    sendChangeMessage();
+}
+
+void WaveformPyramid::finishPoint(int level, int channel) {
+    const int nch = numChannels.load();
+    auto& acc = accumulators.getReference(level * nch + channel);
+    if (acc.numSamples == 0) return;
+
+    const auto rms = std::sqrt(acc.sumOfSquares / acc.numSamples);
+    levels.getReference(level * nch + channel).add({ (juce::int8) juce::jlimit(-127, 127, juce::roundToInt(acc.min * 127.0f)),
+                                                     (juce::int8) juce::jlimit(-127, 127, juce::roundToInt(acc.max * 127.0f)),
+                                                     (juce::uint8) juce::jlimit(0, 255, juce::roundToInt(rms * 255.0)) });
+
+    // Each level up is summarised from the exact figures below it, not the rounded points
+    if (level + 1 < numLevels) {
+        auto& parent = accumulators.getReference((level + 1) * nch + channel);
+        parent.add(acc.min, acc.max, acc.sumOfSquares, acc.numSamples);
+        if (parent.numSamples >= getSamplesPerPoint(level + 1)) finishPoint(level + 1, channel);
+    }
+
+    acc = {};
+}
+
+void WaveformPyramid::finishPartialPoints() {
+    for (int level = 0; level < numLevels; ++level)
+        for (int ch = 0; ch < numChannels.load(); ++ch)
+            finishPoint(level, ch);
+}
+
+double WaveformPyramid::getTotalLength() const noexcept {
+    const auto rate = sampleRate.load();
+    return rate > 0.0 ? (double) totalSamples.load() / rate : 0.0;
+}
+
+bool WaveformPyramid::isFullyLoaded() const noexcept {
+    return lengthKnown.load() && totalSamples.load() > 0 && numSamplesFinished.load() >= totalSamples.load();
+}
+
+//==============================================================================
+void WaveformPyramid::saveTo(juce::OutputStream& output) const {
+    const juce::ScopedLock sl (lock);
+
+    output.writeInt(magic);
+    output.writeInt(numChannels.load());
+    output.writeDouble(sampleRate.load());
+    output.writeInt64(totalSamples.load());
+    output.writeInt64(numSamplesFinished.load());
+    output.writeInt(numLevels);
+
+    for (auto& points : levels) {
+        output.writeInt(points.size());
+        output.write(points.begin(), (size_t) points.size() * sizeof (Point));
+    }
+}
+
+bool WaveformPyramid::loadFrom(juce::InputStream& input) {
+    if (input.readInt() != magic) return false;
+
+    const int nch = input.readInt();
+    const double rate = input.readDouble();
+    const auto total = input.readInt64();
+    const auto finished = input.readInt64();
+    if (input.readInt() != numLevels || nch <= 0 || nch > 64 || rate <= 0.0 || total <= 0 || finished > total) return false;
+
+    juce::Array<juce::Array<Point>> loaded;
+    loaded.resize(numLevels * nch);
+
+    for (int i = 0; i < loaded.size(); ++i) {
+        const int num = input.readInt();
+        if (num < 0 || num > total / getSamplesPerPoint(i / nch) + 1) return false;
+
+        auto& points = loaded.getReference(i);
+        points.resize(num);
+        const auto bytes = (size_t) num * sizeof (Point);
+        if ((size_t) input.read(points.begin(), (int) bytes) != bytes) return false;
+    }
+
+    {
+        const juce::ScopedLock sl (lock);
+        levels.swapWith(loaded);
+        accumulators.clearQuick();
+        accumulators.resize(numLevels * nch);
+        numChannels = nch;
+        sampleRate = rate;
+        totalSamples = total;
+        numSamplesFinished = finished;
+        lengthKnown = true;
+    }
+
+    sendChangeMessage();
+    return true;
+}
+
+//==============================================================================
+WaveformPyramid::Column WaveformPyramid::combinePoints(int level, int channel, juce::int64 first, juce::int64 last) const noexcept {
+    const auto& points = levels.getReference(level * numChannels.load() + channel);
+    last = juce::jmin(last, (juce::int64) points.size());
+
+    Column column;
+    if (first < 0 || first >= last) return column;
+
+    float sumOfSquares = 0.0f;
+    column.min = 1.0f;
+    column.max = -1.0f;
+
+    for (auto i = first; i < last; ++i) {
+        const auto& p = points.getReference((int) i);
+        column.min = juce::jmin(column.min, p.min / 127.0f);
+        column.max = juce::jmax(column.max, p.max / 127.0f);
+        const float rms = p.rms / 255.0f;
+        sumOfSquares += rms * rms;
+    }
+
+    column.rms = std::sqrt(sumOfSquares / (float) (last - first));
+    column.valid = true;
+    return column;
+}
+
+float WaveformPyramid::getApproximatePeak() const {
+    const juce::ScopedLock sl (lock);
+    float peak = 0.0f;
+
+    for (int ch = 0; ch < numChannels.load(); ++ch) {
+        const auto column = combinePoints(numLevels - 1, ch, 0, std::numeric_limits<int>::max());
+        if (column.valid) peak = juce::jmax(peak, std::abs(column.min), std::abs(column.max));
+    }
+
+    return peak;
+}
+
+void WaveformPyramid::getApproximateMinMax(double startTime, double endTime, int channelIndex,
+                                           float& minValue, float& maxValue) const noexcept {
+    minValue = maxValue = 0.0f;
+
+    const juce::ScopedLock sl (lock);
+    const auto rate = sampleRate.load();
+    if (rate <= 0.0 || channelIndex < 0 || channelIndex >= numChannels.load()) return;
+
+    // The coarsest level that still has a point inside the range
+    const auto start = (juce::int64) (startTime * rate), end = (juce::int64) (endTime * rate);
+    int level = 0;
+    while (level + 1 < numLevels && getSamplesPerPoint(level + 1) <= end - start) ++level;
+
+    const int perPoint = getSamplesPerPoint(level);
+    const auto column = combinePoints(level, channelIndex, start / perPoint, juce::jmax(start / perPoint + 1, (end + perPoint - 1) / perPoint));
+    if (column.valid) {
+        minValue = column.min;
+        maxValue = column.max;
+    }
+}
+
+//==============================================================================
+void WaveformPyramid::readLevelColumns(int channel, int level, double startSample, double samplesPerPixel) {
+    const juce::ScopedLock sl (lock);
+    const double perPoint = getSamplesPerPoint(level);
+
+    for (int x = 0; x < columns.size(); ++x) {
+        const auto first = (juce::int64) std::floor((startSample + x * samplesPerPixel) / perPoint);
+        const auto last = (juce::int64) std::ceil((startSample + (x + 1) * samplesPerPixel) / perPoint);
+        columns.getReference(x) = combinePoints(level, channel, first, juce::jmax(first + 1, last));
+    }
+}
+
+bool WaveformPyramid::readRawColumns(int channel, double startSample, double samplesPerPixel) {
+    // Only a file has samples to read; audio fed in live is drawn from its levels
+    if (hashCode == 0) return false;
+
+    const auto first = juce::jmax((juce::int64) 0, (juce::int64) std::floor(startSample));
+    const auto last = juce::jmax(first, juce::jmin(totalSamples.load(),
+                                                   (juce::int64) std::ceil(startSample + columns.size() * samplesPerPixel) + 1));
+
+    const juce::ScopedLock rl (rawLock);
+
+    // Only called below finestSamplesPerPoint samples a pixel, so this is at most the width times that. Every
+    // channel, and every paint until the view scrolls out of what's held, is drawn from the same read, which
+    // takes in as much again either side. Until it's been read, the finest level is drawn instead.
+    if (! rawRange.contains(juce::Range<juce::int64>(first, last))) {
+        const auto margin = last - first;
+        const juce::Range<juce::int64> wanted (juce::jmax((juce::int64) 0, first - margin), last + margin);
+
+        if (! requestedRaw.contains(juce::Range<juce::int64>(first, last))) {
+            requestedRaw = wanted;
+            cache.getTimeSliceThread().addTimeSliceClient(this);
+        }
+        return false;
+    }
+
+    if (channel >= rawBuffer.getNumChannels()) return false;
+    const float* samples = rawBuffer.getReadPointer(channel);
+
+    for (int x = 0; x < columns.size(); ++x) {
+        const auto from = juce::jmax(first, (juce::int64) std::floor(startSample + x * samplesPerPixel));
+        const auto to = juce::jmin(last, juce::jmax(from + 1, (juce::int64) std::floor(startSample + (x + 1) * samplesPerPixel)));
+
+        auto& column = columns.getReference(x);
+        column = {};
+        if (to <= from) continue;
+
+        const int offset = (int) (from - rawRange.getStart()), num = (int) (to - from);
+        const auto range = juce::FloatVectorOperations::findMinAndMax(samples + offset, num);
+
+        float sumOfSquares = 0.0f;
+        for (int i = 0; i < num; ++i)
+            sumOfSquares += samples[offset + i] * samples[offset + i];
+
+        column = { range.getStart(), range.getEnd(), std::sqrt(sumOfSquares / (float) num), true };
+    }
+
+    return true;
+}
+
+void WaveformPyramid::drawChannel(juce::Graphics& g, const juce::Rectangle<int>& area, double startTime, double endTime,
+                                  int channelNum, float verticalZoomFactor) {
+    const auto rate = sampleRate.load();
+    if (area.isEmpty() || endTime <= startTime || rate <= 0.0 || channelNum >= numChannels.load()) return;
+
+    const double startSample = startTime * rate;
+    const double samplesPerPixel = (endTime - startTime) * rate / area.getWidth();
+    columns.resize(area.getWidth());
+
+    // The coarsest level with at least a point per pixel, so each column only ever combines a few
+    if (samplesPerPixel >= finestSamplesPerPoint || ! readRawColumns(channelNum, startSample, samplesPerPixel)) {
+        int level = 0;
+        while (level + 1 < numLevels && getSamplesPerPoint(level + 1) <= samplesPerPixel) ++level;
+        readLevelColumns(channelNum, level, startSample, samplesPerPixel);
+    }
+
+    const float mid = (float) area.getCentreY();
+    const float scale = (float) area.getHeight() * 0.5f * verticalZoomFactor;
+    auto toY = [&] (float value) { return juce::jlimit((float) area.getY(), (float) area.getBottom(), mid - value * scale); };
+
+    juce::RectangleList<float> peaks, rmsBands;
+    for (int x = 0; x < columns.size(); ++x) {
+        const auto& column = columns.getReference(x);
+        if (! column.valid) continue;
+
+        const float left = (float) (area.getX() + x);
+        const float top = toY(column.max), bottom = toY(column.min);
+        peaks.addWithoutMerging({ left, top, 1.0f, juce::jmax(1.0f, bottom - top) });
+
+        const float rmsTop = juce::jmax(top, toY(column.rms)), rmsBottom = juce::jmin(bottom, toY(-column.rms));
+        if (rmsBottom > rmsTop) rmsBands.addWithoutMerging({ left, rmsTop, 1.0f, rmsBottom - rmsTop });
+    }
+
+    g.fillRectList(peaks);
+
+    // The RMS shows as a lighter band inside the peaks
+    const juce::Graphics::ScopedSaveState state (g);
+    g.setColour(juce::Colours::white.withAlpha(0.3f));
+    g.fillRectList(rmsBands);
+}
+
+void WaveformPyramid::drawChannels(juce::Graphics& g, const juce::Rectangle<int>& area, double startTime, double endTime,
+                                   float verticalZoomFactor) {
+    const int nch = numChannels.load();
+
+    for (int ch = 0; ch < nch; ++ch) {
+        const int top = area.getY() + area.getHeight() * ch / nch;
+        const int bottom = area.getY() + area.getHeight() * (ch + 1) / nch;
+        drawChannel(g, { area.getX(), top, area.getWidth(), bottom - top }, startTime, endTime, ch, verticalZoomFactor);
+    }
+}
@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    WaveformPyramid.h
+    Created: 18 Oct 2026
+    Author:  Nolan Strait
+
+    A waveform overview at several resolutions, for drawing at any zoom.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+
+/**
+ A waveform overview kept at several resolutions, so a file can be drawn at any zoom with work proportional
+ to the width drawn rather than to the file's length.
+
+ Each level holds the minimum, maximum and RMS of every channel for each run of samples, from
+ finestSamplesPerPoint samples a point at the bottom to four times as many at each level up. Drawing picks the
+ coarsest level that still has a point for every pixel, so no column combines more than a few points. Zoomed in
+ past the finest level, it draws the file's samples directly instead, down to single samples. Those are read on
+ the thumbnail cache's thread when paint() first asks for them, with the finest level drawn until they arrive. With
+ fewer than finestSamplesPerPoint samples to a pixel, that's at most that many per channel for each pixel drawn,
+ plus as much again either side so that scrolling can reuse them.
+
+ The levels are built from the file a chunk at a time on the thumbnail cache's thread, and stored in the cache
+ once finished, so with a PeakCache they're loaded from disk from then on. It stands in for a
+ juce::AudioThumbnail wherever one is drawn, including being fed live through addBlock().
+ */
+class WaveformPyramid : public juce::AudioThumbnailBase, private juce::TimeSliceClient {
+public:
+    /**
+     @param formatManager   Opens the files given to setSource().
+     @param cache           Where finished levels are stored and looked up, and whose thread builds them.
+     */
+    WaveformPyramid(juce::AudioFormatManager& formatManager, juce::AudioThumbnailCache& cache);
+    ~WaveformPyramid() override;
+
+    void clear() override;
+    bool setSource(juce::InputSource* newSource) override;
+    void setReader(juce::AudioFormatReader* newReader, juce::int64 hashCode) override;
+    bool loadFrom(juce::InputStream& input) override;
+    void saveTo(juce::OutputStream& output) const override;
+
+    int getNumChannels() const noexcept override { return numChannels.load(); }
+    double getTotalLength() const noexcept override;
+    bool isFullyLoaded() const noexcept override;
+    juce::int64 getNumSamplesFinished() const noexcept override { return numSamplesFinished.load(); }
+    float getApproximatePeak() const override;
+    void getApproximateMinMax(double startTime, double endTime, int channelIndex,
+                              float& minValue, float& maxValue) const noexcept override;
+    juce::int64 getHashCode() const override { return hashCode; }
+
+    void drawChannel(juce::Graphics& g, const juce::Rectangle<int>& area, double startTime, double endTime,
+                     int channelNum, float verticalZoomFactor) override;
+    void drawChannels(juce::Graphics& g, const juce::Rectangle<int>& area, double startTime, double endTime,
+                      float verticalZoomFactor) override;
+
+    /**
+     Start again from nothing, to be fed audio through addBlock().
+     @param totalSamplesInSource    How much audio there'll be; 0 if it isn't known (such as while recording), in
+                                    which case the length grows with each block until finishLiveInput().
+     */
+    void reset(int numChannels, double sampleRate, juce::int64 totalSamplesInSource) override;
+
+    /** Summarise more audio. Only audio that carries straight on from what's been added already is taken. */
+    void addBlock(juce::int64 sampleNumberInSource, const juce::AudioBuffer<float>& newData,
+                  int startOffsetInBuffer, int numSamples) override;
+
+    /** Mark the end of audio of unknown length, so the runs of samples left over are summarised too. */
+    void finishLiveInput();
+
+    static constexpr int finestSamplesPerPoint = 128;
+    static constexpr int numLevels = 5; // up to 32768 samples a point
+
+    static int getSamplesPerPoint(int level) noexcept { return finestSamplesPerPoint << (2 * level); }
+
+private:
+    /** One run of samples in one channel, as stored. */
+    struct Point {
+        juce::int8 min, max;
+        juce::uint8 rms;
+    };
+
+    /** A run of samples being summarised. */
+    struct Accumulator {
+        float min = 0.0f, max = 0.0f;
+        double sumOfSquares = 0.0;
+        int numSamples = 0;
+
+        void add(float lo, float hi, double squares, int num) noexcept;
+    };
+
+    /** What one pixel column shows. */
+    struct Column {
+        float min = 0.0f, max = 0.0f, rms = 0.0f;
+        bool valid = false;
+    };
+
+    int useTimeSlice() override;
+    void readRequestedRaw(); // the caller holds readerLock
+
+    // The caller holds lock
+    void finishPoint(int level, int channel);
+    void finishPartialPoints();
+    Column combinePoints(int level, int channel, juce::int64 first, juce::int64 last) const noexcept;
+
+    void readLevelColumns(int channel, int level, double startSample, double samplesPerPixel);
+    bool readRawColumns(int channel, double startSample, double samplesPerPixel);
+
+    juce::AudioFormatManager& formatManager;
+    juce::AudioThumbnailCache& cache;
+    juce::int64 hashCode = 0;
+
+    // The file, opened on the cache's thread, which builds from it and reads raw samples from it for paint()
+    juce::CriticalSection readerLock;
+    std::unique_ptr<juce::InputSource> source;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    juce::AudioBuffer<float> readBuffer; // only for the cache's thread
+
+    std::atomic<int> numChannels { 0 };
+    std::atomic<double> sampleRate { 0.0 };
+    std::atomic<juce::int64> totalSamples { 0 }, numSamplesFinished { 0 };
+    std::atomic<bool> lengthKnown { false }; // false while audio of unknown length is being fed in
+
+    // Indexed by level * numChannels + channel
+    juce::CriticalSection lock;
+    juce::Array<juce::Array<Point>> levels;
+    juce::Array<Accumulator> accumulators;
+
+    // Scratch space for drawing, on the message thread
+    juce::Array<Column> columns;
+
+    // The raw samples last read for drawing, which the cache's thread swaps in once it's read the ones asked for
+    juce::CriticalSection rawLock;
+    juce::AudioBuffer<float> rawBuffer;
+    juce::Range<juce::int64> rawRange;      // which samples rawBuffer holds
+    juce::Range<juce::int64> requestedRaw;  // which samples paint() is waiting for, if any
+
+    static constexpr int chunkSize = 65536; // samples read from the file per time slice
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WaveformPyramid)
+};